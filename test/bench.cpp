@@ -0,0 +1,412 @@
+// the benchmark sweep: fetch and parse throughput for each payload format, crossfade blend rate and per-draw time,
+// for square images from 8x8 to 128x128, with the allocations each fetch and draw makes. `make bench` to run it
+#include "host.h"
+
+/// WiFiClient that plays back a response held in memory instead of talking to a server, so a whole fetch
+/// (headers, body framing and payload parser) can be timed. The headers are made up here, the body isn't copied
+class ReplayClient : public WiFiClient
+{
+private:
+	String headers;
+	const uint8_t *body;
+	size_t bodyLength;
+	size_t position = 0;
+	bool open = false;
+
+public:
+	ReplayClient(const char *contentType, const char *responseBody, size_t length) : body((const uint8_t *)responseBody), bodyLength(length)
+	{
+		headers = String("HTTP/1.1 200 OK\r\nContent-Type: ") + contentType + "\r\nContent-Length: " + String((unsigned long)length) + "\r\nConnection: keep-alive\r\n\r\n";
+	}
+
+	int connect(const char *, uint16_t) override
+	{
+		open = true;
+		position = 0;
+		return 1;
+	}
+	uint8_t connected() override { return open; }
+	void stop() override { open = false; }
+	size_t write(uint8_t) override { return 1; }
+	size_t write(const uint8_t *, size_t size) override { return size; }
+	int available() override { return open ? headers.length() + bodyLength - position : 0; }
+
+	int read() override
+	{
+		uint8_t value;
+		return read(&value, 1) == 1 ? value : -1;
+	}
+
+	int read(uint8_t *buffer, size_t size) override
+	{
+		size = min(size, (size_t)available());
+		for (size_t i = 0; i < size; i++, position++)
+		{
+			buffer[i] = position < headers.length() ? headers[position] : body[position - headers.length()];
+		}
+		return size;
+	}
+};
+
+/**
+ * the pixel colour every benchmark payload uses, so the formats decode to the same image
+ */
+inline uint8_t benchmarkColourIndex(uint16_t x, uint16_t y, uint16_t frame)
+{
+	return (x * 8 + y * 8 + frame * 32) & 0xFF;
+}
+
+inline CRGBA benchmarkColour(uint8_t index)
+{
+	return CRGBA(index, 255 - index, index / 2, 255);
+}
+
+/**
+ * build a JSON pixel response in the server's row format, caller frees it
+ */
+char *buildBenchmarkResponse(uint16_t width, uint16_t height, uint16_t frames, size_t &length)
+{
+	// ~11 characters per pixel plus the row metadata
+	const size_t capacity = (size_t)frames * height * (width * 11 + 64) + 256;
+	char *response = (char *)malloc(capacity);
+	if (response == nullptr)
+		return nullptr;
+
+	length = snprintf(response, capacity, "{\"meta\":{\"frames\":%u,\"width\":%u,\"height\":%u,\"backgroundColor\":\"000000\",\"path\":\"benchmark.gif\"},\"rows\":[", frames, width, height);
+	for (uint16_t frame = 0; frame < frames; frame++)
+	{
+		for (uint16_t row = 0; row < height; row++)
+		{
+			length += snprintf(response + length, capacity - length, "%s{\"frame\":%u,\"row\":%u,\"duration\":100,\"pixels\":[", (frame || row) ? "," : "", frame, row);
+			for (uint16_t col = 0; col < width; col++)
+			{
+				length += snprintf(response + length, capacity - length, "%s\"%02x%02x%02xff\"", col ? "," : "", (col * 8) & 0xFF, (row * 8) & 0xFF, (frame * 32) & 0xFF);
+			}
+			length += snprintf(response + length, capacity - length, "]}");
+		}
+	}
+	length += snprintf(response + length, capacity - length, "]}");
+	return response;
+}
+
+/**
+ * the benchmark colour of each pixel, for host::binaryImage()
+ */
+CRGBA benchmarkPixel(uint16_t x, uint16_t y, uint16_t frame)
+{
+	return benchmarkColour(benchmarkColourIndex(x, y, frame));
+}
+
+/// Packs 9 bit LZW codes into the sub-blocks of a GIF image, for the benchmark GIF
+struct BenchmarkGifCodes
+{
+	uint8_t *out;
+	size_t length;
+	size_t blockStart = 0;
+	uint32_t bits = 0;
+	uint8_t bitCount = 0;
+
+	void begin()
+	{
+		blockStart = length++;
+	}
+
+	void byte(uint8_t value)
+	{
+		out[length++] = value;
+		if (length - blockStart - 1 == 255)
+		{
+			out[blockStart] = 255;
+			blockStart = length++;
+		}
+	}
+
+	void code(uint16_t value)
+	{
+		bits |= (uint32_t)value << bitCount;
+		bitCount += 9;
+		while (bitCount >= 8)
+		{
+			byte(bits);
+			bits >>= 8;
+			bitCount -= 8;
+		}
+	}
+
+	void end()
+	{
+		if (bitCount > 0)
+			byte(bits);
+		bits = 0;
+		bitCount = 0;
+		// an empty last block is the terminator itself
+		out[blockStart] = length - blockStart - 1;
+		if (out[blockStart] > 0)
+			out[length++] = 0;
+	}
+};
+
+/**
+ * build a GIF of the same image, caller frees it. the LZW data is all literal codes with a clear code before the
+ * dictionary would need 10 bit codes, so it's quick to write while the decoder still does its full work for every pixel
+ */
+char *buildGifBenchmarkResponse(uint16_t width, uint16_t height, uint16_t frames, size_t &length)
+{
+	const size_t pixels = (size_t)width * height;
+	// 9 bits a pixel, the clear codes, the sub-block lengths and the headers
+	uint8_t *response = (uint8_t *)malloc(frames * (pixels * 10 / 8 + 64) + 800);
+	if (response == nullptr)
+		return nullptr;
+
+	const uint8_t screen[13] = {'G', 'I', 'F', '8', '9', 'a', (uint8_t)width, (uint8_t)(width >> 8), (uint8_t)height, (uint8_t)(height >> 8), 0xF7, 0, 0};
+	memcpy(response, screen, sizeof(screen));
+	length = sizeof(screen);
+	for (int i = 0; i < 256; i++, length += 3)
+	{
+		memcpy(response + length, benchmarkColour(i).raw, 3);
+	}
+
+	BenchmarkGifCodes codes;
+	codes.out = response;
+	for (uint16_t frame = 0; frame < frames; frame++)
+	{
+		// 100ms, drawn over by the next frame
+		const uint8_t control[8] = {0x21, 0xF9, 4, 1 << 2, 10, 0, 0, 0};
+		const uint8_t descriptor[11] = {0x2C, 0, 0, 0, 0, (uint8_t)width, (uint8_t)(width >> 8), (uint8_t)height, (uint8_t)(height >> 8), 0, 8};
+		memcpy(response + length, control, sizeof(control));
+		memcpy(response + length + sizeof(control), descriptor, sizeof(descriptor));
+		codes.length = length + sizeof(control) + sizeof(descriptor);
+		codes.begin();
+		for (size_t i = 0; i < pixels; i++)
+		{
+			if (i % 250 == 0)
+				codes.code(256);
+			codes.code(benchmarkColourIndex(i % width, i / width, frame));
+		}
+		codes.code(257);
+		codes.end();
+		length = codes.length;
+	}
+	response[length++] = 0x3B;
+	return (char *)response;
+}
+
+/**
+ * time a whole fetch of a canned response into `slot`, reporting the throughput, how many allocations it made
+ * and the most it had allocated at once, its buffers included
+ */
+void benchmarkFetch(const char *format, const char *contentType, const char *response, size_t length, ImageSlot &slot)
+{
+	ReplayClient replay(contentType, response, length);
+	const size_t liveBefore = host::liveBytes;
+	const unsigned long allocationsBefore = host::allocations;
+	host::resetPeak();
+	unsigned long elapsed = 0;
+	ImageFetch::State state = ImageFetch::FAILED;
+	{
+		ImageFetch fetch(replay);
+		if (!fetch.allocate(slot.maxWidth))
+		{
+			Serial.println("benchmark: not enough memory");
+			return;
+		}
+		const unsigned long start = micros();
+		fetch.begin("http://benchmark/api/image/pixels", &slot, true);
+		do
+		{
+			state = fetch.advance(50);
+		} while (state != ImageFetch::DONE && state != ImageFetch::FAILED);
+		elapsed = micros() - start;
+	}
+
+	Serial.printf("  %-6s %7u bytes: %6lu us, %6.2f MB/s, %u frames%s, %lu allocations, peak %u bytes\n", format, (unsigned)length, elapsed,
+				  (float)length / max(elapsed, 1UL), slot.frameCount, state == ImageFetch::DONE ? "" : " (failed!)", host::allocations - allocationsBefore,
+				  (unsigned)(host::peakBytes - liveBefore));
+}
+
+/**
+ * time fetching the same image as JSON, binary and GIF through ImageFetch, from memory rather than the network
+ */
+void benchmarkFetchPaths(uint16_t width, uint16_t height, uint16_t frames)
+{
+	ImageSlot slot;
+	if (!slot.allocate(frames, width, height) || !ImageSlot::allocateLoadBuffers(width, height))
+	{
+		Serial.printf("benchmark: not enough memory for %ux%u\n", width, height);
+		ImageSlot::releaseLoadBuffers();
+		return;
+	}
+	Serial.printf("benchmark: fetch and parse %ux%u x %u frames\n", width, height, frames);
+
+	size_t length = 0;
+	char *response = buildBenchmarkResponse(width, height, frames, length);
+	if (response != nullptr)
+		benchmarkFetch("json", "application/json", response, length, slot);
+	free(response);
+
+	const std::string binary = host::binaryImage(width, height, "benchmark.gif", 0, frames, benchmarkPixel);
+	benchmarkFetch("binary", "application/octet-stream", binary.data(), binary.size(), slot);
+
+	response = buildGifBenchmarkResponse(width, height, frames, length);
+	if (response != nullptr)
+		benchmarkFetch("gif", "image/gif", response, length, slot);
+	free(response);
+
+	ImageSlot::releaseLoadBuffers();
+}
+
+/**
+ * time a crossfade's worth of rows through blend_a and through blendBytes
+ */
+void benchmarkBlendKernels(uint16_t width, uint16_t height)
+{
+	const size_t pixels = (size_t)width * height;
+	CRGBA *current = (CRGBA *)malloc(pixels * sizeof(CRGBA));
+	CRGBA *next = (CRGBA *)malloc(pixels * sizeof(CRGBA));
+	CRGBA *out = (CRGBA *)malloc(pixels * sizeof(CRGBA));
+	if (current == nullptr || next == nullptr || out == nullptr)
+	{
+		Serial.println("benchmark: not enough memory");
+		free(current);
+		free(next);
+		free(out);
+		return;
+	}
+	for (size_t i = 0; i < pixels; i++)
+	{
+		current[i] = CRGBA(i, i >> 3, i * 7, 255 - i);
+		next[i] = CRGBA(i * 13, i >> 1, 255 - i, i * 3);
+	}
+
+	// every amount a crossfade steps through
+	unsigned long start = micros();
+	for (int amount = 0; amount < 256; amount += 10)
+	{
+		for (size_t i = 0; i < pixels; i++)
+		{
+			out[i] = blend_a(current[i], next[i], amount);
+		}
+	}
+	const unsigned long perChannelTime = micros() - start;
+
+	start = micros();
+	for (int amount = 0; amount < 256; amount += 10)
+	{
+		for (uint16_t y = 0; y < height; y++)
+		{
+			const size_t offset = (size_t)y * width;
+			blendBytesPacked(current[offset].raw, next[offset].raw, out[offset].raw, width * sizeof(CRGBA), amount);
+		}
+	}
+	const unsigned long packedTime = micros() - start;
+
+	// pixels blended per microsecond is millions per second
+	const float blended = (float)pixels * ((255 + 10) / 10);
+	Serial.printf("benchmark: %ux%u crossfade, blend_a: %lu us (%.1fM pixels/s), packed 32 bit: %lu us (%.1fM pixels/s)\n", width, height,
+				  perChannelTime, blended / max(perChannelTime, 1UL), packedTime, blended / max(packedTime, 1UL));
+#if defined(__SSE2__)
+	start = micros();
+	for (int amount = 0; amount < 256; amount += 10)
+	{
+		for (uint16_t y = 0; y < height; y++)
+		{
+			const size_t offset = (size_t)y * width;
+			blendBytes(current[offset].raw, next[offset].raw, out[offset].raw, width * sizeof(CRGBA), amount);
+		}
+	}
+	const unsigned long sseTime = micros() - start;
+	Serial.printf("  SSE2: %lu us (%.1fM pixels/s)\n", sseTime, blended / max(sseTime, 1UL));
+#endif
+	free(current);
+	free(next);
+	free(out);
+}
+
+/**
+ * time the opaque, overlay and crossfade draws of a sprite (mostly transparent, some partly) at each benchmark size
+ * that fits the client's first screen. borrows its first two image slots, so it runs before any image is fetched into them
+ */
+void benchmarkDrawPaths(PixelArtClient &client)
+{
+	const uint16_t drawsPerPath = 100;
+	const bool configuredTransparency = client.transparency;
+	PixelArtClient::Screen &screen = client.firstScreen;
+	ImageSlot &from = screen.imageSlots[0];
+	ImageSlot &to = screen.imageSlots[1];
+	CRGB background = CRGB(0, 0, 0);
+	screen.mapLeds();
+	for (uint16_t size = 8; size <= min(screen.frameBufferWidth, screen.frameBufferHeight); size *= 2)
+	{
+		from.beginImage(1, size, size);
+		to.beginImage(1, size, size);
+		for (uint16_t y = 0; y < size; y++)
+		{
+			for (uint16_t x = 0; x < size; x++)
+			{
+				const uint8_t alpha = (x + y) % 10 < 3 ? 255 : ((x + y) % 10 == 3 ? 128 : 0);
+				from.setPixel(0, x, y, CRGBA(x * 8, y * 8, 0, alpha));
+				to.setPixel(0, x, y, CRGBA(0, x * 8, y * 8, 255 - alpha));
+			}
+		}
+		from.finishImage();
+		to.finishImage();
+		const FrameView fromFrame = from.seek(0);
+		const FrameView toFrame = to.seek(0);
+
+		unsigned long times[3];
+		uint16_t heapChanges = 0;
+		for (uint8_t path = 0; path < 3; path++)
+		{
+			client.transparency = path == 1 || (path == 2 && configuredTransparency);
+			const unsigned long start = micros();
+			for (uint16_t i = 0; i < drawsPerPath; i++)
+			{
+				const uint32_t heapBefore = ESP.getFreeHeap();
+				if (path < 2)
+					screen.setPixelsFrom2DVector(fromFrame, background);
+				else
+					screen.setPixelsFrom2DVector(fromFrame, toFrame, i * 255 / drawsPerPath, background, background);
+				heapChanges += heapBefore != ESP.getFreeHeap();
+			}
+			times[path] = micros() - start;
+		}
+		Serial.printf("benchmark: %ux%u image on %ux%u segment, opaque %lu us, overlay %lu us, crossfade %lu us, %u of %u changed the free heap\n", size, size,
+					  screen.frameBufferWidth, screen.frameBufferHeight, times[0] / drawsPerPath, times[1] / drawsPerPath, times[2] / drawsPerPath, heapChanges,
+					  3 * drawsPerPath);
+		yield();
+	}
+	client.transparency = configuredTransparency;
+	from.frameCount = 0;
+	to.frameCount = 0;
+	screen.redrawAll = true;
+}
+
+int main()
+{
+	Serial.printEnabled = true;
+	// the sweep measures the heap, it isn't limited by it
+	host::heapSize = 1 << 30;
+	for (uint16_t size = 8; size <= 128; size *= 2)
+	{
+		// fewer frames as they get bigger, the way the device would have to store them
+		benchmarkFetchPaths(size, size, size <= 32 ? 4 : 128 / size);
+		benchmarkBlendKernels(size, size);
+	}
+
+	// the draw paths on a matrix of each size, with each image size that fits it, straight into the stub's LEDs
+	for (uint16_t size = 8; size <= 128; size *= 2)
+	{
+		host::matrix(size, size);
+		PixelArtClient client;
+		client.enabled = true;
+		client.maxFrames = 2;
+		client.pixelArtMode = strip.addEffect(255, &PixelArtClient::mode_pixelart, "Pixel Art");
+		strip.getSegment(0).mode = client.pixelArtMode;
+		if (!client.allocateFrameBuffers())
+			return 1;
+		const unsigned long allocationsBefore = host::allocations;
+		benchmarkDrawPaths(client);
+		Serial.printf("benchmark: %lu allocations in the draws on %ux%u\n", host::allocations - allocationsBefore, size, size);
+	}
+	return 0;
+}
@@ -0,0 +1,212 @@
+// the usermod built for a PC: the stubs stand in for Arduino and WLED, and every allocation is counted so tests and
+// the benchmark can see what the code under test takes from the heap. include this once, from the test's only file
+#pragma once
+
+#include <Arduino.h>
+#include <wled.h>
+#include <cassert>
+#include <chrono>
+#include <malloc.h>
+#include <new>
+#include <sys/stat.h>
+#include <thread>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// tests look at the usermod's internals
+#define private public
+#include "../usermod_pixelart_client.cpp"
+#undef private
+
+namespace host
+{
+	// what ESP.getFreeHeap() counts down from, the free heap of an ESP32 running WLED
+	size_t heapSize = 160 * 1024;
+	// bytes allocated and not freed, the most there have been since resetPeak(), and every allocation made
+	size_t liveBytes = 0;
+	size_t peakBytes = 0;
+	unsigned long allocations = 0;
+	// added to the real clock, so tests can move time on without waiting
+	unsigned long clockOffset = 0;
+
+	inline void resetPeak() { peakBytes = liveBytes; }
+
+	inline void counted(void *pointer)
+	{
+		if (pointer == nullptr)
+			return;
+		allocations++;
+		liveBytes += malloc_usable_size(pointer);
+		peakBytes = max(peakBytes, liveBytes);
+	}
+
+	/**
+	 * a matrix of `width` x `height` LEDs with segment 0 covering it, and no LED map
+	 */
+	void matrix(uint16_t width, uint16_t height)
+	{
+		Segment::maxWidth = width;
+		Segment::maxHeight = height;
+		strip.isMatrix = true;
+		strip.length = width * height;
+		strip.customMappingTable = nullptr;
+		strip.customMappingSize = 0;
+		strip.segments.assign(1, Segment());
+		strip.segments[0].stop = width;
+		strip.segments[0].stopY = height;
+		busses.leds.assign(strip.length, 0);
+	}
+
+	/**
+	 * a binary pixel payload named `path`: `frames` RGBA frames of `width` x `height`, 100ms each. pixel i of a frame
+	 * is (i, seed, 7, 255), unless `colour` gives each pixel's own
+	 */
+	std::string binaryImage(uint16_t width, uint16_t height, const char *path, uint8_t seed = 0, uint16_t frames = 1,
+							CRGBA (*colour)(uint16_t x, uint16_t y, uint16_t frame) = nullptr)
+	{
+		std::string body = "PXAB";
+		body += (char)BinaryImageHeader::version;
+		body += (char)BinaryImageHeader::RGBA;
+		for (uint16_t value : {width, height, frames})
+		{
+			body += (char)(value & 0xFF);
+			body += (char)(value >> 8);
+		}
+		body += std::string(3, '\0');
+		body += (char)strlen(path);
+		body += path;
+		for (uint16_t frame = 0; frame < frames; frame++)
+		{
+			body += (char)100;
+			body += (char)0;
+			for (uint16_t y = 0; y < height; y++)
+			{
+				for (uint16_t x = 0; x < width; x++)
+				{
+					const CRGBA pixel = colour != nullptr ? colour(x, y, frame) : CRGBA(y * width + x, seed, 7, 255);
+					body.append((const char *)pixel.raw, sizeof(CRGBA));
+				}
+			}
+		}
+		return body;
+	}
+
+	/**
+	 * binaryImage() as the server sends it
+	 */
+	std::string binaryResponse(uint16_t width, uint16_t height, const char *path, uint8_t seed = 0, uint16_t frames = 1,
+							   CRGBA (*colour)(uint16_t x, uint16_t y, uint16_t frame) = nullptr)
+	{
+		const std::string body = binaryImage(width, height, path, seed, frames, colour);
+		return "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+	}
+}
+
+// malloc and friends are linked with --wrap, see the Makefile
+extern "C"
+{
+	void *__real_malloc(size_t size);
+	void *__real_calloc(size_t count, size_t size);
+	void *__real_realloc(void *pointer, size_t size);
+	void __real_free(void *pointer);
+
+	void *__wrap_malloc(size_t size)
+	{
+		void *pointer = __real_malloc(size);
+		host::counted(pointer);
+		return pointer;
+	}
+
+	void *__wrap_calloc(size_t count, size_t size)
+	{
+		void *pointer = __real_calloc(count, size);
+		host::counted(pointer);
+		return pointer;
+	}
+
+	void *__wrap_realloc(void *pointer, size_t size)
+	{
+		if (pointer != nullptr)
+			host::liveBytes -= malloc_usable_size(pointer);
+		pointer = __real_realloc(pointer, size);
+		host::counted(pointer);
+		return pointer;
+	}
+
+	void __wrap_free(void *pointer)
+	{
+		if (pointer != nullptr)
+			host::liveBytes -= malloc_usable_size(pointer);
+		__real_free(pointer);
+	}
+}
+
+// String, new Screen and the rest of the C++ allocations go through the same counters
+void *operator new(size_t size)
+{
+	void *pointer = malloc(size);
+	if (pointer == nullptr)
+		throw std::bad_alloc();
+	return pointer;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return malloc(size); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return malloc(size); }
+void operator delete(void *pointer) noexcept { free(pointer); }
+void operator delete[](void *pointer) noexcept { free(pointer); }
+void operator delete(void *pointer, size_t) noexcept { free(pointer); }
+void operator delete[](void *pointer, size_t) noexcept { free(pointer); }
+
+static const auto hostStart = std::chrono::steady_clock::now();
+unsigned long millis() { return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - hostStart).count() + host::clockOffset; }
+unsigned long micros() { return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - hostStart).count() + host::clockOffset * 1000; }
+void yield() {}
+void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+HardwareSerial Serial;
+EspClass ESP;
+uint32_t EspClass::getFreeHeap() { return host::liveBytes < host::heapSize ? host::heapSize - host::liveBytes : 0; }
+
+std::string HostNet::response;
+size_t HostNet::position = 0;
+size_t HostNet::chunk = 1460;
+std::string HostNet::request;
+bool HostNet::open = false;
+bool HostNet::keepOpen = false;
+int HostNet::connects = 0;
+size_t HostNet::arrived = SIZE_MAX;
+
+byte userVar0 = 0;
+byte buttonType[4] = {};
+char mqttDeviceTopic[33] = "wled/host";
+AsyncMqttClient *mqtt = nullptr;
+fs::FS LittleFS;
+
+uint16_t Segment::maxWidth = 0;
+uint16_t Segment::maxHeight = 0;
+WS2812FX strip;
+BusManager busses;
+
+static int matrixLed(int x, int y)
+{
+	if (!strip.isMatrix || x < 0 || y < 0 || x >= Segment::maxWidth || y >= Segment::maxHeight)
+		return -1;
+	uint16_t index = y * Segment::maxWidth + x;
+	if (index < strip.customMappingSize)
+		index = strip.customMappingTable[index];
+	return index < strip.getLengthTotal() ? index : -1;
+}
+
+void WS2812FX::setPixelColorXY(int x, int y, uint32_t colour)
+{
+	const int index = matrixLed(x, y);
+	if (index >= 0)
+		busses.setPixelColor(index, colour);
+}
+
+uint32_t WS2812FX::getPixelColorXY(int x, int y)
+{
+	const int index = matrixLed(x, y);
+	return index >= 0 ? busses.getPixelColor(index) : 0;
+}
@@ -0,0 +1,225 @@
+// just enough of the Arduino core to build the usermod on a PC, for the tests and benchmark in test/
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <strings.h>
+
+typedef uint8_t byte;
+typedef uint8_t fract8;
+using std::max;
+using std::min;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define PROGMEM
+#define PSTR(s) (s)
+#define FPSTR(s) (s)
+#define F(s) (s)
+#define SET_F(s) (s)
+#define strcat_P strcat
+#define strcpy_P strcpy
+#define strncmp_P strncmp
+#define strcmp_P strcmp
+#define strlen_P strlen
+#define memcpy_P memcpy
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define IRAM_ATTR
+#define DEC 10
+#define HEX 16
+
+unsigned long millis();
+unsigned long micros();
+void yield();
+void delay(unsigned long ms);
+
+/// Arduino's String over std::string, only the members the usermod uses
+class String
+{
+public:
+	std::string s;
+
+	String() {}
+	String(const char *c) : s(c ? c : "") {}
+	String(const std::string &c) : s(c) {}
+	String(char c) : s(1, c) {}
+	String(int v) : s(std::to_string(v)) {}
+	String(unsigned v) : s(std::to_string(v)) {}
+	String(long v) : s(std::to_string(v)) {}
+	String(unsigned long v) : s(std::to_string(v)) {}
+
+	const char *c_str() const { return s.c_str(); }
+	unsigned length() const { return s.size(); }
+	bool isEmpty() const { return s.empty(); }
+	bool reserve(unsigned n)
+	{
+		s.reserve(n);
+		return true;
+	}
+	void clear() { s.clear(); }
+	bool startsWith(const String &o) const { return s.rfind(o.s, 0) == 0; }
+	bool endsWith(const String &o) const { return s.size() >= o.s.size() && s.compare(s.size() - o.s.size(), o.s.size(), o.s) == 0; }
+	int indexOf(char c, unsigned from = 0) const
+	{
+		const size_t p = s.find(c, from);
+		return p == std::string::npos ? -1 : (int)p;
+	}
+	int indexOf(const String &c, unsigned from = 0) const
+	{
+		const size_t p = s.find(c.s, from);
+		return p == std::string::npos ? -1 : (int)p;
+	}
+	String substring(unsigned from) const { return from > s.size() ? String() : String(s.substr(from)); }
+	String substring(unsigned from, unsigned to) const { return from > s.size() ? String() : String(s.substr(from, to - from)); }
+	int toInt() const { return atoi(s.c_str()); }
+	void toLowerCase()
+	{
+		for (char &c : s)
+			c = tolower(c);
+	}
+	void trim()
+	{
+		while (!s.empty() && isspace((unsigned char)s.back()))
+			s.pop_back();
+		while (!s.empty() && isspace((unsigned char)s.front()))
+			s.erase(0, 1);
+	}
+	bool equalsIgnoreCase(const String &o) const { return strcasecmp(s.c_str(), o.s.c_str()) == 0; }
+	char operator[](unsigned i) const { return s[i]; }
+	char charAt(unsigned i) const { return s[i]; }
+	String &operator+=(const String &o)
+	{
+		s += o.s;
+		return *this;
+	}
+	String &operator+=(const char *o)
+	{
+		s += o;
+		return *this;
+	}
+	String &operator+=(char o)
+	{
+		s += o;
+		return *this;
+	}
+	bool operator==(const String &o) const { return s == o.s; }
+	bool operator==(const char *o) const { return s == o; }
+	bool operator!=(const String &o) const { return s != o.s; }
+};
+
+inline String operator+(const String &a, const String &b) { return String(a.s + b.s); }
+inline String operator+(const String &a, const char *b) { return String(a.s + b); }
+inline String operator+(const char *a, const String &b) { return String(a + b.s); }
+
+/// Output goes to stdout, and only once `printEnabled` is set, so the tests stay quiet
+class Print
+{
+public:
+	bool printEnabled = false;
+
+	virtual ~Print() {}
+	virtual size_t write(uint8_t) { return 1; }
+	virtual size_t write(const uint8_t *buffer, size_t size)
+	{
+		for (size_t i = 0; i < size; i++)
+			write(buffer[i]);
+		return size;
+	}
+	size_t write(const char *text) { return write((const uint8_t *)text, strlen(text)); }
+
+	size_t print(const char *text) { return printEnabled ? fputs(text, stdout), strlen(text) : 0; }
+	size_t print(const String &text) { return print(text.c_str()); }
+	size_t print(char c) { return print(String(c)); }
+	template <class T>
+	size_t print(T value, int = DEC) { return print(String(std::to_string(value))); }
+	template <class T>
+	size_t println(const T &value)
+	{
+		const size_t n = print(value);
+		return n + println();
+	}
+	template <class T>
+	size_t println(T value, int base) { return println(value); }
+	size_t println() { return print("\n"); }
+	size_t printf(const char *format, ...)
+	{
+		if (!printEnabled)
+			return 0;
+		va_list args;
+		va_start(args, format);
+		const int n = vprintf(format, args);
+		va_end(args);
+		return n;
+	}
+};
+
+class Stream : public Print
+{
+public:
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+	virtual void flush() {}
+
+	virtual size_t readBytes(uint8_t *buffer, size_t size)
+	{
+		size_t i = 0;
+		for (int c; i < size && (c = read()) >= 0; i++)
+			buffer[i] = c;
+		return i;
+	}
+	size_t readBytes(char *buffer, size_t size) { return readBytes((uint8_t *)buffer, size); }
+	bool find(const char *target)
+	{
+		const size_t length = strlen(target);
+		size_t matched = 0;
+		for (int c; (c = read()) >= 0;)
+		{
+			if (c == target[matched])
+			{
+				if (++matched == length)
+					return true;
+			}
+			else
+				matched = c == target[0] ? 1 : 0;
+		}
+		return false;
+	}
+	// single character targets are all the usermod looks for
+	bool findUntil(const char *target, const char *terminator)
+	{
+		for (int c; (c = read()) >= 0;)
+		{
+			if (c == target[0])
+				return true;
+			if (c == terminator[0])
+				return false;
+		}
+		return false;
+	}
+	void setTimeout(unsigned long) {}
+};
+
+class HardwareSerial : public Stream
+{
+public:
+	int available() override { return 0; }
+	int read() override { return -1; }
+	int peek() override { return -1; }
+	size_t write(uint8_t c) override { return printEnabled ? putchar(c), 1 : 1; }
+};
+extern HardwareSerial Serial;
+
+/// The free heap is the host heap size less what the code has allocated and not freed, see host.h
+struct EspClass
+{
+	uint32_t getFreeHeap();
+	uint32_t getMaxAllocHeap() { return getFreeHeap(); }
+	uint32_t getMinFreeHeap() { return getFreeHeap(); }
+};
+extern EspClass ESP;
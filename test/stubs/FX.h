@@ -0,0 +1,2 @@
+// included by the usermod, nothing in it is needed on the host
+#pragma once
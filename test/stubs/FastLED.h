@@ -0,0 +1,45 @@
+// the FastLED pieces the usermod uses, blend8 as FastLED 3.5 computes it without assembly
+#pragma once
+
+#include <Arduino.h>
+
+inline uint8_t blend8(uint8_t a, uint8_t b, uint8_t amountOfB)
+{
+	uint16_t partial = (a << 8) | b;
+	partial += b * amountOfB;
+	partial -= a * amountOfB;
+	return partial >> 8;
+}
+
+struct CRGB
+{
+	union
+	{
+		struct
+		{
+			union
+			{
+				uint8_t r;
+				uint8_t red;
+			};
+			union
+			{
+				uint8_t g;
+				uint8_t green;
+			};
+			union
+			{
+				uint8_t b;
+				uint8_t blue;
+			};
+		};
+		uint8_t raw[3];
+	};
+
+	CRGB() = default;
+	CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) {}
+	CRGB(uint32_t colour) : r((colour >> 16) & 0xFF), g((colour >> 8) & 0xFF), b(colour & 0xFF) {}
+	operator uint32_t() const { return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b; }
+	bool operator==(const CRGB &o) const { return r == o.r && g == o.g && b == o.b; }
+	bool operator!=(const CRGB &o) const { return !(*this == o); }
+};
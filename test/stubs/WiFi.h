@@ -0,0 +1,87 @@
+// a WiFiClient that plays back one canned response instead of talking to a server
+#pragma once
+
+#include <Arduino.h>
+
+/// The response every connection plays back, handed out `chunk` bytes at a time the way a socket delivers a few
+/// packets per read. What the client sent is kept in `request`
+struct HostNet
+{
+	static std::string response;
+	static size_t position;
+	static size_t chunk;
+	static std::string request;
+	static bool open;
+	// leave the connection up once the response is read, as a kept-alive one would be
+	static bool keepOpen;
+	static int connects;
+	// how much of the response has reached the client, the rest is still on its way
+	static size_t arrived;
+
+	static void reply(const std::string &text)
+	{
+		response = text;
+		position = 0;
+		arrived = SIZE_MAX;
+	}
+};
+
+class Client : public Stream
+{
+public:
+	virtual int connect(const char *host, uint16_t port) = 0;
+	virtual uint8_t connected() = 0;
+	virtual void stop() = 0;
+	virtual int read(uint8_t *buffer, size_t size) = 0;
+	using Stream::read;
+	using Print::write;
+	operator bool() { return connected(); }
+};
+
+class WiFiClient : public Client
+{
+public:
+	int connect(const char *, uint16_t) override
+	{
+		HostNet::connects++;
+		HostNet::position = 0;
+		HostNet::request.clear();
+		HostNet::open = true;
+		return 1;
+	}
+	uint8_t connected() override { return HostNet::open && (HostNet::keepOpen || HostNet::position < HostNet::response.size()); }
+	void stop() override { HostNet::open = false; }
+	void setNoDelay(bool) {}
+
+	size_t write(uint8_t c) override
+	{
+		HostNet::request += (char)c;
+		return 1;
+	}
+	size_t write(const uint8_t *buffer, size_t size) override
+	{
+		HostNet::request.append((const char *)buffer, size);
+		return size;
+	}
+	template <class T>
+	size_t print(const T &value)
+	{
+		const String text = String(value);
+		return write((const uint8_t *)text.c_str(), text.length());
+	}
+
+	int available() override
+	{
+		const size_t end = min(HostNet::arrived, HostNet::response.size());
+		return HostNet::open && end > HostNet::position ? (int)min(HostNet::chunk, end - HostNet::position) : 0;
+	}
+	int peek() override { return HostNet::position < HostNet::response.size() ? (uint8_t)HostNet::response[HostNet::position] : -1; }
+	int read() override { return HostNet::position < HostNet::response.size() ? (uint8_t)HostNet::response[HostNet::position++] : -1; }
+	int read(uint8_t *buffer, size_t size) override
+	{
+		size = min(size, (size_t)available());
+		memcpy(buffer, HostNet::response.data() + HostNet::position, size);
+		HostNet::position += size;
+		return size;
+	}
+};
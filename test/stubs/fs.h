@@ -0,0 +1,50 @@
+// a filesystem with nothing on it where every file fails to open, tests cache through DirectoryCacheStore instead
+#pragma once
+
+#include <Arduino.h>
+
+namespace fs
+{
+	enum SeekMode
+	{
+		SeekSet,
+		SeekCur,
+		SeekEnd
+	};
+
+	class File : public Stream
+	{
+	public:
+		operator bool() const { return false; }
+		int available() override { return 0; }
+		int read() override { return -1; }
+		int peek() override { return -1; }
+		size_t read(uint8_t *buffer, size_t size) { return readBytes(buffer, size); }
+		using Print::write;
+		bool seek(uint32_t, SeekMode = SeekSet) { return false; }
+		size_t size() const { return 0; }
+		size_t position() const { return 0; }
+		void close() {}
+		bool isDirectory() { return false; }
+		File openNextFile() { return File(); }
+		const char *name() const { return ""; }
+	};
+
+	class FS
+	{
+	public:
+		File open(const char *, const char * = "r") { return File(); }
+		File open(const String &path, const char *mode = "r") { return open(path.c_str(), mode); }
+		bool exists(const char *) { return false; }
+		bool exists(const String &) { return false; }
+		bool remove(const char *) { return false; }
+		bool remove(const String &) { return false; }
+		bool rename(const char *, const char *) { return false; }
+		bool mkdir(const char *) { return false; }
+		bool mkdir(const String &) { return false; }
+	};
+}
+
+using fs::File;
+using fs::FS;
+extern fs::FS LittleFS;
@@ -0,0 +1,355 @@
+// ArduinoJson's interface over a small document tree: deserializeJson() reads a whole document and lookups find what's
+// in it, so what the usermod makes of a response can be tested. everything written is dropped, and a document's
+// capacity isn't enforced
+#pragma once
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/// one value of a parsed document. an object's members are `items`, named by `keys` in the same order
+struct JsonNode
+{
+	enum Type
+	{
+		NUL,
+		BOOLEAN,
+		NUMBER,
+		STRING,
+		ARRAY,
+		OBJECT
+	};
+
+	Type type = NUL;
+	bool boolean = false;
+	double number = 0;
+	std::string text;
+	std::vector<std::string> keys;
+	std::vector<JsonNode> items;
+};
+
+class JsonObject;
+class JsonArray;
+
+class JsonVariant
+{
+protected:
+	// nullptr for anything missing, and for everything written
+	const JsonNode *node = nullptr;
+
+	inline bool isType(JsonNode::Type type) const { return node != nullptr && node->type == type; }
+
+public:
+	JsonVariant(const JsonNode *value = nullptr) : node(value) {}
+
+	template <class T>
+	T as() const
+	{
+		if constexpr (std::is_same<T, const char *>::value)
+			return isType(JsonNode::STRING) ? node->text.c_str() : nullptr;
+		else if constexpr (std::is_same<T, String>::value)
+			return isType(JsonNode::STRING) ? String(node->text.c_str()) : String();
+		else if constexpr (std::is_same<T, bool>::value)
+			return isType(JsonNode::BOOLEAN) && node->boolean;
+		else if constexpr (std::is_arithmetic<T>::value || std::is_enum<T>::value)
+			return isType(JsonNode::NUMBER) ? (T)node->number : T();
+		else if constexpr (std::is_base_of<JsonVariant, T>::value)
+			return T(node);
+		else
+			return T();
+	}
+	template <class T>
+	operator T() const { return as<T>(); }
+	template <class T>
+	JsonVariant &operator=(const T &) { return *this; }
+
+	template <class T>
+	JsonVariant operator[](T key) const
+	{
+		if constexpr (std::is_integral<T>::value)
+		{
+			return isType(JsonNode::ARRAY) && key >= 0 && (size_t)key < node->items.size() ? JsonVariant(&node->items[key]) : JsonVariant();
+		}
+		else
+		{
+			if (!isType(JsonNode::OBJECT))
+				return JsonVariant();
+			const std::string name = String(key).c_str();
+			for (size_t i = 0; i < node->keys.size(); i++)
+			{
+				if (node->keys[i] == name)
+					return JsonVariant(&node->items[i]);
+			}
+			return JsonVariant();
+		}
+	}
+
+	template <class T>
+	bool is() const
+	{
+		if constexpr (std::is_same<T, const char *>::value || std::is_same<T, String>::value)
+			return isType(JsonNode::STRING);
+		else if constexpr (std::is_same<T, bool>::value)
+			return isType(JsonNode::BOOLEAN);
+		else if constexpr (std::is_arithmetic<T>::value)
+			return isType(JsonNode::NUMBER);
+		else if constexpr (std::is_same<T, JsonArray>::value)
+			return isType(JsonNode::ARRAY);
+		else if constexpr (std::is_same<T, JsonObject>::value)
+			return isType(JsonNode::OBJECT);
+		else
+			return false;
+	}
+	bool isNull() const { return node == nullptr || node->type == JsonNode::NUL; }
+
+	template <class T>
+	T operator|(T fallback) const
+	{
+		if constexpr (std::is_same<T, bool>::value)
+			return isType(JsonNode::BOOLEAN) ? node->boolean : fallback;
+		else if constexpr (std::is_arithmetic<T>::value)
+			return isType(JsonNode::NUMBER) ? (T)node->number : fallback;
+		else
+			return fallback;
+	}
+	const char *operator|(const char *fallback) const { return isType(JsonNode::STRING) ? node->text.c_str() : fallback; }
+
+	template <class T>
+	bool add(const T &) { return false; }
+	JsonObject createNestedObject();
+	template <class T>
+	JsonObject createNestedObject(T);
+	JsonArray createNestedArray();
+	template <class T>
+	JsonArray createNestedArray(T);
+};
+
+/// walks an array's elements, each a JsonVariant
+class JsonArrayIterator
+{
+	const JsonNode *item;
+
+public:
+	JsonArrayIterator(const JsonNode *first) : item(first) {}
+	JsonVariant operator*() const { return JsonVariant(item); }
+	JsonArrayIterator &operator++()
+	{
+		item++;
+		return *this;
+	}
+	bool operator!=(const JsonArrayIterator &other) const { return item != other.item; }
+};
+
+class JsonArray : public JsonVariant
+{
+public:
+	using JsonVariant::JsonVariant;
+	JsonArrayIterator begin() const { return JsonArrayIterator(isType(JsonNode::ARRAY) ? node->items.data() : nullptr); }
+	JsonArrayIterator end() const { return JsonArrayIterator(isType(JsonNode::ARRAY) ? node->items.data() + node->items.size() : nullptr); }
+	size_t size() const { return isType(JsonNode::ARRAY) ? node->items.size() : 0; }
+};
+
+class JsonObject : public JsonVariant
+{
+public:
+	using JsonVariant::JsonVariant;
+};
+
+inline JsonObject JsonVariant::createNestedObject() { return JsonObject(); }
+template <class T>
+JsonObject JsonVariant::createNestedObject(T) { return JsonObject(); }
+inline JsonArray JsonVariant::createNestedArray() { return JsonArray(); }
+template <class T>
+JsonArray JsonVariant::createNestedArray(T) { return JsonArray(); }
+
+struct DeserializationError
+{
+	bool failed = false;
+
+	explicit operator bool() const { return failed; }
+	const char *c_str() const { return failed ? "InvalidInput" : "Ok"; }
+};
+
+/// reads one JSON value off the front of `text`, false if it's malformed
+class JsonReader
+{
+	const char *text;
+	const char *end;
+
+	void skipSpace()
+	{
+		while (text < end && (*text == ' ' || *text == '\n' || *text == '\r' || *text == '\t'))
+			text++;
+	}
+
+	bool literal(const char *word)
+	{
+		const size_t length = strlen(word);
+		if ((size_t)(end - text) < length || strncmp(text, word, length) != 0)
+			return false;
+		text += length;
+		return true;
+	}
+
+	bool string(std::string &out)
+	{
+		if (text >= end || *text++ != '"')
+			return false;
+		while (text < end && *text != '"')
+		{
+			char c = *text++;
+			if (c == '\\')
+			{
+				if (text >= end)
+					return false;
+				c = *text++;
+				if (c == 'n')
+					c = '\n';
+				else if (c == 't')
+					c = '\t';
+				else if (c == 'r')
+					c = '\r';
+				else if (c == 'b')
+					c = '\b';
+				else if (c == 'f')
+					c = '\f';
+				else if (c == 'u')
+				{
+					// only what the tests send, anything past ASCII comes out as '?'
+					if (end - text < 4)
+						return false;
+					const long code = strtol(std::string(text, 4).c_str(), nullptr, 16);
+					text += 4;
+					c = code < 0x80 ? (char)code : '?';
+				}
+			}
+			out += c;
+		}
+		if (text >= end)
+			return false;
+		text++;
+		return true;
+	}
+
+public:
+	JsonReader(const char *input, size_t length) : text(input), end(input + length) {}
+
+	bool value(JsonNode &out)
+	{
+		skipSpace();
+		if (text >= end)
+			return false;
+		if (*text == '"')
+		{
+			out.type = JsonNode::STRING;
+			return string(out.text);
+		}
+		if (*text == '[' || *text == '{')
+		{
+			const bool array = *text++ == '[';
+			out.type = array ? JsonNode::ARRAY : JsonNode::OBJECT;
+			skipSpace();
+			if (text < end && *text == (array ? ']' : '}'))
+			{
+				text++;
+				return true;
+			}
+			while (true)
+			{
+				if (!array)
+				{
+					skipSpace();
+					out.keys.emplace_back();
+					if (!string(out.keys.back()))
+						return false;
+					skipSpace();
+					if (text >= end || *text++ != ':')
+						return false;
+				}
+				out.items.emplace_back();
+				if (!value(out.items.back()))
+					return false;
+				skipSpace();
+				if (text >= end)
+					return false;
+				const char c = *text++;
+				if (c == (array ? ']' : '}'))
+					return true;
+				if (c != ',')
+					return false;
+			}
+		}
+		if (literal("true") || literal("false"))
+		{
+			out.type = JsonNode::BOOLEAN;
+			out.boolean = text[-2] == 'u';
+			return true;
+		}
+		if (literal("null"))
+			return true;
+		const char *start = text;
+		while (text < end && (isdigit(*text) || *text == '-' || *text == '+' || *text == '.' || *text == 'e' || *text == 'E'))
+			text++;
+		if (text == start)
+			return false;
+		out.type = JsonNode::NUMBER;
+		out.number = strtod(std::string(start, text).c_str(), nullptr);
+		return true;
+	}
+
+	bool finished()
+	{
+		skipSpace();
+		return text == end || *text == '\0';
+	}
+};
+
+class JsonDocument : public JsonObject
+{
+	std::unique_ptr<JsonNode> root;
+
+public:
+	void clear()
+	{
+		root.reset();
+		node = nullptr;
+	}
+
+	DeserializationError read(const char *input, size_t length)
+	{
+		root.reset(new JsonNode());
+		JsonReader reader(input, length);
+		DeserializationError error;
+		error.failed = !reader.value(*root) || !reader.finished();
+		node = error.failed ? nullptr : root.get();
+		return error;
+	}
+
+	template <class T>
+	T to() { return T(); }
+};
+
+class DynamicJsonDocument : public JsonDocument
+{
+public:
+	DynamicJsonDocument(size_t) {}
+};
+
+template <size_t capacity>
+class StaticJsonDocument : public JsonDocument
+{
+};
+
+template <class Document>
+DeserializationError deserializeJson(Document &, Stream &) { return DeserializationError(); }
+template <class Document>
+DeserializationError deserializeJson(Document &doc, char *input, size_t length) { return doc.read(input, length); }
+template <class Document>
+size_t serializeJson(const Document &, char *buffer, size_t size)
+{
+	if (size > 0)
+		buffer[0] = 0;
+	return 0;
+}
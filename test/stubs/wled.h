@@ -0,0 +1,133 @@
+// the parts of WLED the usermod touches: a matrix with an optional LED map, the buses behind it, MQTT, the usermod
+// base class and a JSON document that stores nothing
+#pragma once
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include <HTTPClient.h>
+#include <set>
+#include <vector>
+#include "json.h"
+#include "fs.h"
+
+#define FRAMETIME 24
+#define USERMOD_ID_EXAMPLE 1
+#define CALL_MODE_DIRECT_CHANGE 1
+#define WLED_CONNECTED true
+#define WLED_MQTT_CONNECTED (mqtt != nullptr)
+#define WLED_FS LittleFS
+#define BTN_TYPE_NONE 0
+#define BTN_TYPE_RESERVED 1
+#define BTN_TYPE_PIR_SENSOR 2
+#define BTN_TYPE_ANALOG 3
+#define BTN_TYPE_ANALOG_INVERTED 4
+#define RGBW32(r, g, b, w) ((uint32_t(w) << 24) | (uint32_t(r) << 16) | (uint32_t(g) << 8) | uint32_t(b))
+
+extern byte userVar0;
+extern byte buttonType[];
+extern char mqttDeviceTopic[33];
+
+/// Keeps the topics subscribed to, so tests can see them
+struct AsyncMqttClient
+{
+	std::set<std::string> topics;
+
+	uint16_t publish(const char *, uint8_t, bool, const char *, size_t = 0) { return 1; }
+	uint16_t subscribe(const char *topic, uint8_t)
+	{
+		topics.insert(topic);
+		return 1;
+	}
+	uint16_t unsubscribe(const char *topic)
+	{
+		topics.erase(topic);
+		return 1;
+	}
+};
+extern AsyncMqttClient *mqtt;
+
+struct Segment
+{
+	uint16_t start = 0;
+	uint16_t stop = 0;
+	uint16_t startY = 0;
+	uint16_t stopY = 0;
+	uint8_t mode = 0;
+	// size of the whole matrix
+	static uint16_t maxWidth;
+	static uint16_t maxHeight;
+
+	uint16_t width() const { return stop - start; }
+	uint16_t height() const { return stopY - startY; }
+};
+
+/// The strip as WLED 0.14 has it for a 2D setup: pixel x, y of the matrix is LED y * maxWidth + x, looked up in
+/// customMappingTable if that's long enough, and dropped if that's past the last LED
+struct WS2812FX
+{
+	bool isMatrix = true;
+	uint16_t *customMappingTable = nullptr;
+	uint16_t customMappingSize = 0;
+	uint16_t length = 0;
+	std::vector<Segment> segments;
+
+	uint8_t getSegmentsNum() { return segments.size(); }
+	Segment &getSegment(uint8_t id) { return segments[id]; }
+	uint16_t getLengthTotal() { return length; }
+	uint8_t getBrightness() { return 128; }
+	bool isUpdating() { return false; }
+	uint8_t addEffect(uint8_t, uint16_t (*)(), const char *) { return 180; }
+
+	void setPixelColorXY(int x, int y, uint32_t colour);
+	void setPixelColorXY(int x, int y, CRGB colour) { setPixelColorXY(x, y, (uint32_t)colour); }
+	uint32_t getPixelColorXY(int x, int y);
+};
+extern WS2812FX strip;
+
+/// The LED colours, one per LED of the strip
+struct BusManager
+{
+	std::vector<uint32_t> leds;
+	// every LED write, so tests can check what a draw touched
+	unsigned long writes = 0;
+
+	void setPixelColor(uint16_t index, uint32_t colour)
+	{
+		writes++;
+		if (index < leds.size())
+			leds[index] = colour & 0xFFFFFF;
+	}
+	uint32_t getPixelColor(uint16_t index) { return index < leds.size() ? leds[index] : 0; }
+};
+extern BusManager busses;
+
+class Usermod
+{
+public:
+	virtual ~Usermod() {}
+	virtual void setup() {}
+	virtual void connected() {}
+	virtual void loop() {}
+	virtual void handleOverlayDraw() {}
+	virtual bool handleButton(uint8_t) { return false; }
+	virtual void addToJsonInfo(JsonObject &) {}
+	virtual void addToJsonState(JsonObject &) {}
+	virtual void readFromJsonState(JsonObject &) {}
+	virtual void addToConfig(JsonObject &) {}
+	virtual bool readFromConfig(JsonObject &) { return true; }
+	virtual void appendConfigData() {}
+	virtual bool onMqttMessage(char *, char *) { return false; }
+	virtual void onMqttConnect(bool) {}
+	virtual void onStateChange(uint8_t) {}
+	virtual uint16_t getId() { return 0; }
+};
+
+inline bool oappend(const char *) { return true; }
+template <class T>
+bool getJsonValue(const JsonVariant &, T &) { return false; }
+template <class T, class U>
+bool getJsonValue(const JsonVariant &, T &value, U fallback)
+{
+	value = fallback;
+	return false;
+}
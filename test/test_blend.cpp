@@ -0,0 +1,63 @@
+// the crossfade kernels against FastLED's blend8, byte for byte
+#include "host.h"
+
+int main()
+{
+	// every pair of bytes at every amount, through the packed kernel and the one the draw path calls
+	uint8_t from[256];
+	uint8_t to[256];
+	uint8_t packed[256];
+	uint8_t dispatched[256];
+	for (int b = 0; b < 256; b++)
+		to[b] = b;
+	for (int amount = 0; amount < 256; amount++)
+	{
+		for (int a = 0; a < 256; a++)
+		{
+			memset(from, a, sizeof(from));
+			blendBytesPacked(from, to, packed, sizeof(packed), amount);
+			blendBytes(from, to, dispatched, sizeof(dispatched), amount);
+			for (int b = 0; b < 256; b++)
+			{
+				assert(packed[b] == blend8(a, b, amount));
+				assert(dispatched[b] == blend8(a, b, amount));
+			}
+		}
+	}
+
+	// rows of CRGBA and CRGB pixels of every length up to a few words, starting anywhere, against blend_a per pixel.
+	// the output can be the row being faded from, as it is when a crossfade blends in place
+	uint8_t rowFrom[4 * 40 + 3];
+	uint8_t rowTo[4 * 40 + 3];
+	uint8_t row[4 * 40 + 3];
+	for (size_t i = 0; i < sizeof(rowFrom); i++)
+	{
+		rowFrom[i] = i * 37 + 11;
+		rowTo[i] = 255 - i * 53;
+	}
+	for (int amount : {0, 1, 127, 128, 200, 254, 255})
+	{
+		for (size_t offset = 0; offset < 4; offset++)
+		{
+			for (size_t pixels = 0; pixels <= 40; pixels++)
+			{
+				const size_t bytes = pixels * sizeof(CRGBA);
+				memcpy(row, rowFrom, sizeof(row));
+				blendBytes(row + offset, rowTo + offset, row + offset, bytes, amount);
+				for (size_t i = 0; i < pixels; i++)
+				{
+					const CRGBA expected = blend_a(*(const CRGBA *)(rowFrom + offset + i * 4), *(const CRGBA *)(rowTo + offset + i * 4), amount);
+					assert(memcmp(row + offset + i * 4, expected.raw, sizeof(CRGBA)) == 0);
+				}
+				assert(memcmp(row + offset + bytes, rowFrom + offset + bytes, sizeof(row) - offset - bytes) == 0);
+
+				// flattened frames blend 3 bytes a pixel
+				blendBytesPacked(rowFrom + offset, rowTo + offset, row, pixels * 3, amount);
+				for (size_t i = 0; i < pixels * 3; i++)
+					assert(row[i] == blend8(rowFrom[offset + i], rowTo[offset + i], amount));
+			}
+		}
+	}
+	puts("blend ok");
+	return 0;
+}
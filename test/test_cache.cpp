@@ -0,0 +1,198 @@
+// the image cache in a plain directory: a fetched image is saved a piece per loop after it arrives and read back
+// when it comes round again, entries are evicted least recently used first, and the index outlives a restart
+#include "host.h"
+#include <unistd.h>
+
+/**
+ * a single frame image named `name` in `slot`, shaded by `seed`
+ */
+static void fillSlot(ImageSlot &slot, const char *name, uint8_t seed)
+{
+	slot.beginImage(1, 16, 8);
+	slot.setDuration(0, 100);
+	for (uint16_t y = 0; y < 8; y++)
+	{
+		for (uint16_t x = 0; x < 16; x++)
+			slot.setPixel(0, x, y, CRGBA(x, y, seed, 255));
+	}
+	slot.finishImage();
+	slot.name = name;
+}
+
+/**
+ * a whole save of `slot` at once, true if it made it into the cache
+ */
+static bool save(ImageCache &cache, uint32_t key, const ImageSlot &slot)
+{
+	if (!cache.beginSave(key, slot))
+		return false;
+	while (cache.saveNext())
+	{
+	}
+	return cache.find(key) >= 0;
+}
+
+/**
+ * every frame a different red, so each one shows and none is stored as a delta of the one before
+ */
+static CRGBA frameColour(uint16_t x, uint16_t y, uint16_t frame)
+{
+	return CRGBA(frame * 6, x * 16 + y, 255 - frame * 6, 255);
+}
+
+/**
+ * the blue of a pixel of the slot's first frame, read back as the draw path would
+ */
+static uint8_t shade(ImageSlot &slot, uint16_t x, uint16_t y)
+{
+	CRGBA row[16];
+	return slot.seek(0).row(y, row)[x].b;
+}
+
+int main()
+{
+	char directory[] = "/tmp/pixelart_cacheXXXXXX";
+	assert(mkdtemp(directory) != nullptr);
+	DirectoryCacheStore store(directory);
+
+	host::heapSize = 1 << 20;
+	host::matrix(16, 8);
+	PixelArtClient client;
+	client.enabled = true;
+	client.serverUp = true;
+	client.pixelArtMode = strip.addEffect(255, &PixelArtClient::mode_pixelart, "Pixel Art");
+	strip.getSegment(0).mode = client.pixelArtMode;
+	assert(client.allocateFrameBuffers());
+	PixelArtClient::Screen &screen = client.firstScreen;
+	ImageCache cache(store);
+	cache.begin(64 * 1024);
+	client.fetch.setCache(&cache);
+
+	// the pass that reads the last of the image doesn't write it to flash, the ones after do, a piece each
+	HostNet::reply(host::binaryResponse(16, 8, "a.gif", 1));
+	for (int i = 0; i < 200 && !screen.imageLoaded; i++)
+	{
+		client.loop();
+		host::clockOffset += 50;
+	}
+	assert(screen.imageLoaded && screen.currentImage->name == "a.gif");
+	assert(client.fetch.hasPendingSave() && cache.count() == 0);
+	HostNet::reply(host::binaryResponse(16, 8, "b.gif", 2));
+	client.loop();
+	assert(client.fetch.hasPendingSave() && cache.count() == 0);
+	for (int i = 0; i < 10 && client.fetch.hasPendingSave(); i++)
+		client.loop();
+	assert(!client.fetch.hasPendingSave() && cache.count() == 1);
+
+	// a different image is saved in turn, then the first sent again loads from the cache once the response names it
+	for (int i = 0; i < 200 && cache.count() < 2; i++)
+	{
+		client.loop();
+		host::clockOffset += 50;
+	}
+	assert(cache.count() == 2 && client.metrics.imagesFetched == 2);
+	HostNet::reply(host::binaryResponse(16, 8, "a.gif", 1));
+	for (int i = 0; i < 200 && client.metrics.imagesFetched < 3; i++)
+	{
+		client.loop();
+		host::clockOffset += 50;
+	}
+	assert(client.metrics.cacheHits == 1 && cache.count() == 2);
+	client.loop();
+	assert(!client.fetch.hasPendingSave());
+
+	// an animation too big to write in one go takes a loop for each 4KB of it, and it carries on playing in between.
+	// the next download waits for it
+	client.fetch.reset();
+	if (client.fetchingScreen != nullptr)
+		screen.dropLoadingImage();
+	client.fetchingScreen = nullptr;
+	screen.readyCount = 0;
+	screen.nextImageTime = millis();
+	screen.fetchRetryTime = millis();
+	HostNet::reply(host::binaryResponse(16, 8, "big.gif", 0, 40, frameColour));
+	for (int i = 0; i < 200 && !client.fetch.hasPendingSave(); i++)
+	{
+		client.loop();
+		host::clockOffset += 50;
+	}
+	assert(client.fetch.hasPendingSave() && cache.saving->name == "big.gif");
+	const ImageSlot &big = *cache.saving;
+	const size_t chunks = (big.arenaUsed + ImageCache::saveChunk - 1) / ImageCache::saveChunk;
+	assert(chunks >= 2);
+	HostNet::reply(host::binaryResponse(16, 8, "e.gif", 5));
+	const int connects = HostNet::connects;
+	int loops = 0;
+	uint32_t shown = strip.getPixelColorXY(0, 0);
+	int changes = 0;
+	while (client.fetch.hasPendingSave())
+	{
+		client.loop();
+		loops++;
+		assert(HostNet::connects == connects && loops < 100);
+		host::clockOffset += 200;
+		client.handleOverlayDraw();
+		changes += strip.getPixelColorXY(0, 0) != shown;
+		shown = strip.getPixelColorXY(0, 0);
+	}
+	assert(loops >= (int)chunks + 3 && changes >= 2 && cache.count() == 3 && screen.currentImage == &big);
+
+	// a save given up part way through leaves nothing of itself behind
+	assert(cache.beginSave(ImageCache::keyFor("copy.gif", 16, 8), big));
+	for (int i = 0; i < 4; i++)
+		assert(client.fetch.hasPendingSave() && cache.saveNext());
+	char partial[16];
+	ImageCache::entryName(ImageCache::keyFor("copy.gif", 16, 8), partial);
+	assert(store.size(partial) > 0);
+	client.fetch.cancelSave();
+	assert(!client.fetch.hasPendingSave() && store.size(partial) == 0 && cache.count() == 3);
+
+	// room for two entries: a is used again after b, so c evicts b
+	ImageSlot slot;
+	assert(slot.allocate(1, 16, 8));
+	const uint32_t a = ImageCache::keyFor("a.gif", 16, 8);
+	const uint32_t b = ImageCache::keyFor("b.gif", 16, 8);
+	const uint32_t c = ImageCache::keyFor("c.gif", 16, 8);
+	cache.clear();
+	fillSlot(slot, "a.gif", 1);
+	assert(save(cache, a, slot));
+	const size_t entryBytes = cache.bytesUsed();
+	cache.begin(2 * entryBytes + entryBytes / 2);
+	assert(cache.count() == 1);
+	fillSlot(slot, "b.gif", 2);
+	assert(save(cache, b, slot) && cache.count() == 2);
+	String name;
+	assert(cache.load(a, slot, name) && name == "a.gif" && shade(slot, 3, 2) == 1);
+	fillSlot(slot, "c.gif", 3);
+	assert(save(cache, c, slot) && cache.count() == 2);
+	assert(!cache.load(b, slot, name));
+	assert(cache.load(c, slot, name) && name == "c.gif" && shade(slot, 3, 2) == 3);
+
+	// the index is read back by a cache starting over on the same store, and trimmed to a smaller budget
+	ImageCache restarted(store);
+	restarted.begin(2 * entryBytes + entryBytes / 2);
+	assert(restarted.count() == 2 && restarted.load(a, slot, name) && name == "a.gif");
+	restarted.begin(entryBytes);
+	assert(restarted.count() == 1 && restarted.bytesUsed() <= entryBytes);
+
+	// a slot given up before its turn to be saved leaves nothing in the cache
+	restarted.clear();
+	client.fetch.setCache(&restarted);
+	ImageSlot given;
+	assert(given.allocate(1, 16, 8));
+	HostNet::reply(host::binaryResponse(16, 8, "d.gif", 4));
+	client.fetch.reset();
+	client.fetch.begin("http://host/api/image/pixels", &given, false);
+	while (client.fetch.advance(50) != ImageFetch::DONE)
+		assert(client.fetch.isBusy());
+	assert(client.fetch.hasPendingSave());
+	given.release();
+	client.fetch.saveToCache();
+	assert(restarted.count() == 0);
+
+	restarted.clear();
+	store.remove("index");
+	rmdir(directory);
+	puts("cache ok");
+	return 0;
+}
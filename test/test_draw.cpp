@@ -0,0 +1,65 @@
+// the draw path doesn't allocate: frame flips through delta frames, scaled images and a whole crossfade, with
+// transparency and palette frames each on and off
+#include "host.h"
+
+/**
+ * load a 6 frame image with a pixel in 4 opaque, the rest see-through, into the screen's queue
+ */
+static void queueImage(PixelArtClient::Screen &screen, uint16_t width, uint16_t height, bool palette, uint8_t shade)
+{
+	ImageSlot *slot = screen.freeImageSlot();
+	assert(slot != nullptr);
+	screen.loadingImage = slot;
+	slot->beginImage(6, width, height, palette);
+	for (uint16_t frame = 0; frame < 6; frame++)
+	{
+		slot->setDuration(frame, 0);
+		for (uint16_t y = 0; y < height; y++)
+		{
+			for (uint16_t x = 0; x < width; x++)
+				slot->setPixel(frame, x, y, CRGBA(x * 8 + shade, y * 16, frame * 40, (x + frame) % 4 == 0 ? 255 : 0));
+		}
+	}
+	slot->finishImage();
+	screen.imageReceived();
+}
+
+int main()
+{
+	host::heapSize = 1 << 20;
+	host::matrix(32, 16);
+	for (bool transparency : {false, true})
+	{
+		for (bool palette : {false, true})
+		{
+			PixelArtClient client;
+			client.enabled = true;
+			client.transparency = transparency;
+			client.pixelArtMode = strip.addEffect(255, &PixelArtClient::mode_pixelart, "Pixel Art");
+			strip.getSegment(0).mode = client.pixelArtMode;
+			assert(client.allocateFrameBuffers());
+			PixelArtClient::Screen &screen = client.firstScreen;
+
+			// the segment's size, then one scaled up to it, crossfading from the first to the second
+			queueImage(screen, 32, 16, palette, 0);
+			queueImage(screen, 8, 8, palette, 100);
+			screen.showNextImage();
+			screen.showNextImage();
+			assert(screen.crossfading);
+
+			const unsigned long allocations = host::allocations;
+			const size_t liveBytes = host::liveBytes;
+			const unsigned long writes = busses.writes;
+			for (int i = 0; i < 2000; i++)
+			{
+				client.handleOverlayDraw();
+				// the crossfade ends a quarter of the way through
+				host::clockOffset += 2;
+			}
+			assert(!screen.crossfading && busses.writes > writes);
+			assert(host::allocations == allocations && host::liveBytes == liveBytes);
+		}
+	}
+	puts("draw ok");
+	return 0;
+}
@@ -0,0 +1,106 @@
+// the GIF decoder on frames at the edges of what it handles: a frame placed near the 16 bit limit doesn't wrap round
+// onto the top left, and a frame dropped past what fits doesn't keep what the frame before saved for it
+#include "host.h"
+
+/**
+ * the start of a GIF of `width` x `height` with four global colours: black, red, green, blue
+ */
+static std::string screen(uint16_t width, uint16_t height)
+{
+	std::string gif = "GIF89a";
+	gif += {(char)width, (char)(width >> 8), (char)height, (char)(height >> 8), (char)0x81, 0, 0};
+	gif += std::string("\0\0\0\xff\0\0\0\xff\0\0\0\xff", 12);
+	return gif;
+}
+
+/**
+ * a frame of one colour, disposed of by `disposal`. each code follows a clear code, so they all stay 3 bits long
+ */
+static void frame(std::string &gif, uint16_t left, uint16_t top, uint16_t width, uint16_t height, uint8_t disposal, uint8_t colour)
+{
+	gif += {0x21, (char)0xF9, 4, (char)(disposal << 2), 10, 0, 0, 0};
+	gif += {0x2C, (char)left, (char)(left >> 8), (char)top, (char)(top >> 8), (char)width, (char)(width >> 8), (char)height, (char)(height >> 8), 0, 2};
+
+	std::string data;
+	uint32_t bits = 0;
+	uint8_t count = 0;
+	auto code = [&](uint8_t value) {
+		bits |= value << count;
+		count += 3;
+		while (count >= 8)
+		{
+			data += (char)bits;
+			bits >>= 8;
+			count -= 8;
+		}
+	};
+	for (uint32_t i = 0; i < (uint32_t)width * height; i++)
+	{
+		code(4);
+		code(colour);
+	}
+	code(5);
+	if (count > 0)
+		data += (char)bits;
+	for (size_t i = 0; i < data.size(); i += 255)
+	{
+		const size_t block = std::min((size_t)255, data.size() - i);
+		gif += (char)block;
+		gif += data.substr(i, block);
+	}
+	gif += '\0';
+}
+
+/**
+ * decode the whole of `gif` into `slot`
+ */
+static void decode(GifDecoder &decoder, ImageSlot &slot, const std::string &gif)
+{
+	assert(decoder.begin(&slot, false));
+	for (char c : gif)
+		decoder.feed(c);
+	assert(decoder.getPhase() == GifDecoder::DONE);
+	slot.finishImage();
+}
+
+int main()
+{
+	host::heapSize = 1 << 20;
+	ImageSlot slot;
+	assert(slot.allocate(2, 4, 2) && ImageSlot::allocateLoadBuffers(4, 2));
+	GifDecoder decoder;
+	CRGBA row[4];
+
+	// a blue frame starting two pixels short of 65536 each way is off the matrix, none of it lands on the red under it
+	std::string gif = screen(4, 2);
+	frame(gif, 0, 0, 4, 2, 0, 1);
+	frame(gif, 65534, 65534, 6, 6, 0, 3);
+	gif += '\x3B';
+	decode(decoder, slot, gif);
+	assert(slot.frameCount == 2);
+	for (uint16_t y = 0; y < 2; y++)
+	{
+		const CRGBA *pixels = slot.seek(1).row(y, row);
+		for (uint16_t x = 0; x < 4; x++)
+			assert(pixels[x].r == 255 && pixels[x].b == 0 && pixels[x].a == 255);
+	}
+
+	// the second frame saves what it covers to put back after, the third is past what fits and gives that up
+	gif = screen(4, 2);
+	frame(gif, 0, 0, 4, 2, 0, 1);
+	frame(gif, 1, 1, 1, 1, 3, 2);
+	frame(gif, 0, 0, 4, 2, 0, 3);
+	assert(decoder.begin(&slot, false));
+	for (char c : gif)
+		decoder.feed(c);
+	assert(decoder.saved == nullptr && decoder.getPhase() == GifDecoder::DECODING);
+	decoder.feed(0x3B);
+	assert(decoder.getPhase() == GifDecoder::DONE);
+	slot.finishImage();
+	assert(slot.frameCount == 2 && slot.seek(1).row(1, row)[1].g == 255);
+
+	decoder.release();
+	ImageSlot::releaseLoadBuffers();
+	puts("gif ok");
+	return 0;
+}
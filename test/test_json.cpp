@@ -0,0 +1,61 @@
+// the streaming JSON parser on numbers too big for what they index: long digit strings don't overflow, and frame,
+// row and size numbers past 16 bits are a parse error rather than wrapping onto another frame
+#include "host.h"
+
+/**
+ * feed a whole response to a fresh parser, loading into `slot`
+ */
+static PixelJsonParser::Phase parse(ImageSlot &slot, const std::string &response)
+{
+	PixelJsonParser parser;
+	assert(parser.allocate(4));
+	parser.begin(&slot, false);
+	// ImageFetch stops feeding at an error, so does this
+	for (size_t i = 0; i < response.size() && parser.getPhase() != PixelJsonParser::ERROR; i++)
+		parser.feed(response[i]);
+	if (parser.getPhase() == PixelJsonParser::DONE)
+		slot.finishImage();
+	return parser.getPhase();
+}
+
+/**
+ * a 4x2 image of two frames, with `meta` added to its meta object and `row` to its first row
+ */
+static std::string image(const std::string &meta, const std::string &row)
+{
+	std::string response = "{\"meta\":{\"frames\":2,\"width\":4,\"height\":2,\"backgroundColor\":\"000000\",\"path\":\"n.gif\"" + meta + "},\"rows\":[";
+	for (int frame = 0; frame < 2; frame++)
+	{
+		for (int y = 0; y < 2; y++)
+		{
+			response += (frame || y) ? "," : "";
+			response += "{\"frame\":" + std::to_string(frame) + ",\"row\":" + std::to_string(y) + (frame || y ? std::string(",\"duration\":100") : row) +
+						",\"pixels\":[\"102030ff\",\"102030ff\",\"102030ff\",\"102030ff\"]}";
+		}
+	}
+	return response + "]}";
+}
+
+int main()
+{
+	ImageSlot slot;
+	assert(slot.allocate(2, 4, 2) && ImageSlot::allocateLoadBuffers(4, 2));
+
+	assert(parse(slot, image("", ",\"duration\":100")) == PixelJsonParser::DONE && slot.frameCount == 2);
+
+	// a number far past 32 bits where nothing reads it, and a duration past 16 bits, which holds the frame as long as it can
+	const std::string digits(40, '9');
+	assert(parse(slot, image(",\"checksum\":" + digits + ",\"offset\":-" + digits, ",\"duration\":" + digits)) == PixelJsonParser::DONE);
+	assert(slot.frameCount == 2 && slot.durations[0] == UINT16_MAX);
+
+	// frames, rows and sizes that don't fit 16 bits, including ones that would wrap round onto frame 0
+	assert(parse(slot, image("", ",\"duration\":100,\"frame\":65536")) == PixelJsonParser::ERROR);
+	assert(parse(slot, image("", ",\"duration\":100,\"row\":" + digits)) == PixelJsonParser::ERROR);
+	assert(parse(slot, image("", ",\"duration\":100,\"frame\":-3")) == PixelJsonParser::ERROR);
+	assert(parse(slot, image(",\"frames\":70000", ",\"duration\":100")) == PixelJsonParser::ERROR);
+	assert(parse(slot, image(",\"width\":" + digits, ",\"duration\":100")) == PixelJsonParser::ERROR);
+
+	ImageSlot::releaseLoadBuffers();
+	puts("json ok");
+	return 0;
+}
@@ -0,0 +1,149 @@
+// a screen's LED indices against strip.setPixelColorXY(), for plain matrices, LED maps and panel layouts, and
+// after whatever they were worked out from changes
+#include "host.h"
+
+/**
+ * every pixel of the segment goes to the LED the stub strip would write it to, or to none that exists
+ */
+static void checkIndices(PixelArtClient::Screen &screen)
+{
+	screen.mapLeds();
+	const Segment &segment = strip.getSegment(screen.segmentId);
+	for (uint16_t y = 0; y < screen.frameBufferHeight; y++)
+	{
+		const uint16_t *leds = screen.ledRow(y);
+		for (uint16_t x = 0; x < screen.frameBufferWidth; x++)
+		{
+			const int expected = matrixLed(segment.start + x, segment.startY + y);
+			if (expected < 0)
+				assert(leds[x] >= strip.getLengthTotal());
+			else
+				assert(leds[x] == expected);
+		}
+	}
+}
+
+/**
+ * the LED map WLED 0.14 builds for a matrix of panels, each `panelWidth` x `panelHeight` and wired the same way
+ */
+static std::vector<uint16_t> panelMap(uint16_t panelsWide, uint16_t panelsHigh, uint16_t panelWidth, uint16_t panelHeight, bool bottomStart, bool rightStart,
+									  bool vertical, bool serpentine)
+{
+	std::vector<uint16_t> table((size_t)panelsWide * panelWidth * panelsHigh * panelHeight, UINT16_MAX);
+	uint16_t pixel = 0;
+	for (uint16_t panelY = 0; panelY < panelsHigh; panelY++)
+	{
+		for (uint16_t panelX = 0; panelX < panelsWide; panelX++)
+		{
+			const uint16_t h = vertical ? panelHeight : panelWidth;
+			const uint16_t v = vertical ? panelWidth : panelHeight;
+			for (uint16_t j = 0; j < v; j++)
+			{
+				for (uint16_t i = 0; i < h; i++)
+				{
+					const uint16_t y = (vertical ? rightStart : bottomStart) ? v - j - 1 : j;
+					uint16_t x = (vertical ? bottomStart : rightStart) ? h - i - 1 : i;
+					x = serpentine && j % 2 ? h - x - 1 : x;
+					table[(panelY * panelHeight + (vertical ? x : y)) * panelsWide * panelWidth + panelX * panelWidth + (vertical ? y : x)] = pixel++;
+				}
+			}
+		}
+	}
+	return table;
+}
+
+int main()
+{
+	host::heapSize = 1 << 20;
+	host::matrix(16, 8);
+	// the screen draws on a segment inside the matrix
+	strip.getSegment(0).start = 3;
+	strip.getSegment(0).stop = 13;
+	strip.getSegment(0).startY = 2;
+	strip.getSegment(0).stopY = 8;
+	PixelArtClient client;
+	client.enabled = true;
+	client.maxFrames = 1;
+	assert(client.allocateFrameBuffers());
+	PixelArtClient::Screen &screen = client.firstScreen;
+	assert(screen.frameBufferWidth == 10 && screen.frameBufferHeight == 6);
+
+	// no LED map
+	checkIndices(screen);
+
+	// every wiring of a 2x2 panel matrix of 8x4 panels
+	std::vector<uint16_t> table;
+	for (int wiring = 0; wiring < 16; wiring++)
+	{
+		table = panelMap(2, 2, 8, 4, wiring & 1, wiring & 2, wiring & 4, wiring & 8);
+		strip.customMappingTable = table.data();
+		strip.customMappingSize = table.size();
+		checkIndices(screen);
+	}
+
+	// a map covering only the first rows, and one with gaps and LEDs past the end of the strip
+	table.assign(16 * 4, 0);
+	for (size_t i = 0; i < table.size(); i++)
+		table[i] = table.size() - 1 - i;
+	strip.customMappingTable = table.data();
+	strip.customMappingSize = table.size();
+	checkIndices(screen);
+	table.assign(16 * 8, 0);
+	for (size_t i = 0; i < table.size(); i++)
+		table[i] = i % 5 == 0 ? UINT16_MAX : (i % 7 == 0 ? 500 : i);
+	strip.customMappingSize = table.size();
+	strip.customMappingTable = table.data();
+	checkIndices(screen);
+
+	// the same sized map loaded again where the old one was is picked up once the check comes round
+	for (size_t i = 0; i < table.size(); i++)
+		table[i] = (i * 37) % table.size();
+	screen.redrawAll = false;
+	host::clockOffset += PixelArtClient::Screen::ledsCheckInterval;
+	checkIndices(screen);
+	assert(screen.redrawAll);
+	// and when nothing changed the image isn't drawn again for it
+	screen.redrawAll = false;
+	host::clockOffset += PixelArtClient::Screen::ledsCheckInterval;
+	checkIndices(screen);
+	assert(!screen.redrawAll);
+
+	// the matrix losing rows, the segment moving, and 2D turned off
+	strip.customMappingTable = nullptr;
+	strip.customMappingSize = 0;
+	Segment::maxHeight = 5;
+	checkIndices(screen);
+	Segment::maxHeight = 8;
+	strip.getSegment(0).start = 6;
+	strip.getSegment(0).stop = 16;
+	checkIndices(screen);
+	strip.isMatrix = false;
+	checkIndices(screen);
+	strip.isMatrix = true;
+	checkIndices(screen);
+
+	// drawing through the indices lights the LEDs strip.setPixelColorXY() does, and nothing else
+	table = panelMap(2, 2, 8, 4, true, false, true, true);
+	strip.customMappingTable = table.data();
+	strip.customMappingSize = table.size();
+	screen.mapLeds();
+	std::vector<uint32_t> expected(strip.getLengthTotal(), 0);
+	busses.leds.assign(strip.getLengthTotal(), 0);
+	for (uint16_t y = 0; y < screen.frameBufferHeight; y++)
+	{
+		for (uint16_t x = 0; x < screen.frameBufferWidth; x++)
+			strip.setPixelColorXY(strip.getSegment(0).start + x, strip.getSegment(0).startY + y, RGBW32(x + 1, y + 1, 7, 0));
+	}
+	expected.swap(busses.leds);
+	for (uint16_t y = 0; y < screen.frameBufferHeight; y++)
+	{
+		CRGB row[10];
+		for (uint16_t x = 0; x < screen.frameBufferWidth; x++)
+			row[x] = CRGB(x + 1, y + 1, 7);
+		screen.blitRow(y, row);
+	}
+	assert(busses.leds == expected);
+
+	puts("leds ok");
+	return 0;
+}
@@ -0,0 +1,207 @@
+// the playlist manifest is read a slice at a time through the image fetch and parsed into the screen's list, an entry
+// with a key loads from the cache without a request while one without is only looked up once its response names it,
+// a screen keeping its own schedule waits for its list rather than have the server pick, and an entry the server
+// answers unchanged keeps its own duration
+#include "host.h"
+#include <unistd.h>
+
+/**
+ * a response with no body but its status line
+ */
+static std::string emptyResponse(const char *status)
+{
+	return std::string("HTTP/1.1 ") + status + "\r\nContent-Length: 0\r\n\r\n";
+}
+
+/**
+ * a manifest as the server sends it
+ */
+static std::string manifestResponse(const std::string &manifest)
+{
+	return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " + std::to_string(manifest.size()) + "\r\n\r\n" + manifest;
+}
+
+/**
+ * put a one frame image named `name` straight into the cache, as an earlier download would have
+ */
+static void cacheImage(ImageCache &cache, const char *name)
+{
+	ImageSlot slot;
+	assert(slot.allocate(1, 16, 8));
+	// the screen's slots flatten while transparency is off, and only take an image cached the same way
+	slot.flattenOnLoad = true;
+	slot.beginImage(1, 16, 8);
+	slot.setDuration(0, 100);
+	for (uint16_t y = 0; y < 8; y++)
+	{
+		for (uint16_t x = 0; x < 16; x++)
+			slot.setPixel(0, x, y, CRGBA(x, y, 0, 255));
+	}
+	slot.finishImage();
+	slot.name = name;
+	assert(cache.beginSave(ImageCache::keyFor(name, 16, 8), slot));
+	while (cache.saveNext())
+	{
+	}
+}
+
+/**
+ * loop() and a redraw, which puts the next image up once it's due, with the clock moving on a little each time,
+ * until `done` or it's clearly not going to happen
+ */
+template <class Condition>
+static void loopUntil(PixelArtClient &client, Condition done)
+{
+	for (int i = 0; i < 1000 && !done(); i++)
+	{
+		client.loop();
+		client.handleOverlayDraw();
+		host::clockOffset += 20;
+	}
+}
+
+/**
+ * loopUntil() for a second, less than a screen waits after a failed request
+ */
+static void loopForASecond(PixelArtClient &client)
+{
+	int loops = 0;
+	loopUntil(client, [&] { return loops++ == 50; });
+}
+
+int main()
+{
+	char directory[] = "/tmp/pixelart_manifestXXXXXX";
+	assert(mkdtemp(directory) != nullptr);
+	DirectoryCacheStore store(directory);
+
+	host::heapSize = 1 << 20;
+	host::matrix(16, 8);
+	PixelArtClient client;
+	client.enabled = true;
+	client.serverUp = true;
+	client.manifestImages = 4;
+	client.pixelArtMode = strip.addEffect(255, &PixelArtClient::mode_pixelart, "Pixel Art");
+	strip.getSegment(0).mode = client.pixelArtMode;
+	assert(client.allocateFrameBuffers());
+	PixelArtClient::Screen &screen = client.firstScreen;
+	ImageCache cache(store);
+	cache.begin(64 * 1024);
+	client.fetch.setCache(&cache);
+	cacheImage(cache, "cat.gif");
+	cacheImage(cache, "dog.gif");
+
+	// a manifest still on its way holds up nothing, each loop reads what there is and returns
+	const std::string manifest = "{\"images\":[{\"id\":\"1\",\"key\":\"cat.gif\",\"duration\":5},{\"id\":\"\"},{\"key\":\"x.gif\"},{\"id\":\"2\"},"
+								 "{\"id\":\"3\",\"key\":\"dog.gif\",\"duration\":7}],\"next\":\"n1\"}";
+	HostNet::reply(manifestResponse(manifest));
+	HostNet::arrived = HostNet::response.size() - manifest.size() + 10;
+	for (int i = 0; i < 5; i++)
+	{
+		client.loop();
+		host::clockOffset += 20;
+	}
+	assert(HostNet::request.rfind("GET /api/image/manifest?", 0) == 0 && HostNet::request.find("&from=") == std::string::npos);
+	assert(client.fetch.getState() == ImageFetch::DOCUMENT && client.manifestBuffer != nullptr && client.metrics.manifests == 0);
+
+	// entries without an id are skipped, a missing key stays empty rather than taking the id, and a missing duration is
+	// 0. the first entry goes straight to a request that looks for its key in the cache before connecting
+	HostNet::arrived = SIZE_MAX;
+	client.loop();
+	assert(client.metrics.manifests == 1 && client.manifestBuffer == nullptr && screen.playlistCursor == "n1");
+	assert(screen.playlistCount == 2);
+	assert(screen.playlistEntries[0].id == "2" && screen.playlistEntries[0].cacheName == "" && screen.playlistEntries[0].duration == 0);
+	assert(screen.playlistEntries[1].id == "3" && screen.playlistEntries[1].cacheName == "dog.gif" && screen.playlistEntries[1].duration == 7);
+	assert(client.fetch.expectedName == "cat.gif" && screen.loadingImage->duration == 5);
+	int connects = HostNet::connects;
+	HostNet::reply(manifestResponse("{\"images\":[],\"next\":\"n2\"}"));
+	loopUntil(client, [&] { return client.metrics.cacheHits == 1; });
+	assert(client.metrics.cacheHits == 1 && HostNet::connects == connects && screen.imageLoaded && screen.currentImage->name == "cat.gif");
+
+	// two left is low, so the next request is for more, carrying on from where the list left off. an empty list back
+	// is tried again later rather than straight away
+	loopUntil(client, [&] { return client.metrics.manifests == 2; });
+	assert(HostNet::request.find("&count=2&from=n1") != std::string::npos);
+	assert(screen.playlistCursor == "n2" && (long)(screen.manifestRetryTime - millis()) > 4000);
+
+	// that same pass takes the next entry. without a key it's asked for, and loads from the cache once the response
+	// names it, here not its id
+	assert(screen.playlistCount == 1 && screen.playlistEntries[0].id == "3");
+	assert(client.fetch.getState() == ImageFetch::CONNECT && client.fetch.expectedName == "");
+	HostNet::reply(host::binaryResponse(16, 8, "dog.gif"));
+	loopUntil(client, [&] { return client.metrics.cacheHits == 2; });
+	assert(client.metrics.cacheHits == 2 && HostNet::request.find("&image=2") != std::string::npos);
+	assert(screen.readyCount == 1 && screen.readyImages[0]->name == "dog.gif");
+
+	// one with a key doesn't need the server at all
+	const std::string sent = HostNet::request;
+	connects = HostNet::connects;
+	loopUntil(client, [&] { return client.metrics.cacheHits == 3; });
+	assert(client.metrics.cacheHits == 3 && HostNet::request == sent && HostNet::connects == connects && screen.playlistCount == 0);
+
+	// the list ran out and the screen waits for the next one, rather than ask the server for whatever it likes
+	loopForASecond(client);
+	assert(HostNet::request == sent && HostNet::connects == connects && client.metrics.manifests == 2);
+
+	// a failed manifest is tried again after a while, and still no image is asked for in between
+	HostNet::reply(emptyResponse("500 Internal Server Error"));
+	loopUntil(client, [&] { return client.metrics.manifestFailures > 0; });
+	assert(client.metrics.manifestFailures == 1 && !client.fetch.isBusy() && HostNet::request.find("&from=n2") != std::string::npos);
+	const std::string failed = HostNet::request;
+	loopForASecond(client);
+	assert(HostNet::request == failed && client.metrics.manifestFailures == 1);
+	loopUntil(client, [&] { return client.metrics.manifestFailures > 1; });
+	assert(client.metrics.manifestFailures == 2);
+
+	// a server without manifests picks each image itself
+	HostNet::reply(emptyResponse("404 Not Found"));
+	loopUntil(client, [&] { return screen.manifestUnsupported; });
+	assert(screen.manifestUnsupported && !screen.scheduledLocally());
+	HostNet::reply(host::binaryResponse(16, 8, "x.gif"));
+	const uint32_t fetched = client.metrics.imagesFetched;
+	loopUntil(client, [&] { return client.metrics.imagesFetched > fetched; });
+	assert(HostNet::request.find("/api/image/pixels?") != std::string::npos && HostNet::request.find("&image=") == std::string::npos);
+
+	// back on a playlist with x.gif showing and nothing lined up
+	client.fetch.reset();
+	if (client.fetchingScreen != nullptr)
+		screen.dropLoadingImage();
+	client.fetchingScreen = nullptr;
+	screen.readyCount = 0;
+	screen.nextImage = nullptr;
+	screen.manifestUnsupported = false;
+	screen.manifestRetryTime = millis() + 1000000;
+	loopUntil(client, [&] { return !client.fetch.hasPendingSave(); });
+	screen.currentImage = screen.imageSlots[0].name == "x.gif" ? &screen.imageSlots[0] : &screen.imageSlots[1];
+	assert(screen.currentImage->name == "x.gif");
+
+	// an entry whose key is the image showing just keeps it up for its own time too, no request made
+	PixelArtClient::PlaylistEntry entry;
+	entry.id = "x";
+	entry.cacheName = "x.gif";
+	entry.duration = 20;
+	const unsigned long due = screen.nextImageTime;
+	assert(screen.repeatImage(entry) && screen.nextImageTime == due + 20000);
+	// without a key it can't be told apart, so it's asked for
+	entry.cacheName = "";
+	assert(!screen.repeatImage(entry));
+
+	// the server answers an entry with the image showing, which then stays up for that entry's time, and the next
+	// entry is asked for straight away rather than once it's due
+	assert(screen.addPlaylistEntry("y", "y.gif", 30) && screen.addPlaylistEntry("z", "", 0));
+	screen.nextImageTime = millis();
+	screen.fetchRetryTime = millis();
+	const uint32_t unchanged = client.metrics.unchanged;
+	loopUntil(client, [&] { return client.metrics.unchanged > unchanged; });
+	assert(client.metrics.unchanged == unchanged + 1);
+	assert((long)(screen.nextImageTime - millis()) > 29000 && (long)(screen.nextImageTime - millis()) <= 30000);
+	assert(client.fetch.isBusy() && screen.playlistCount == 0);
+	client.loop();
+	assert(HostNet::request.find("&image=z") != std::string::npos);
+
+	cache.clear();
+	store.remove("index");
+	rmdir(directory);
+	puts("manifest ok");
+	return 0;
+}
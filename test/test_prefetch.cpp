@@ -0,0 +1,58 @@
+// prefetch slots are given up while the heap is low and taken back once it recovers, and the screen keeps fetching
+// through it all
+#include "host.h"
+
+int main()
+{
+	host::matrix(16, 8);
+	PixelArtClient client;
+	client.enabled = true;
+	client.prefetchImages = 2;
+	client.pixelArtMode = strip.addEffect(255, &PixelArtClient::mode_pixelart, "Pixel Art");
+	strip.getSegment(0).mode = client.pixelArtMode;
+	assert(client.allocateFrameBuffers());
+	PixelArtClient::Screen &screen = client.firstScreen;
+	assert(screen.imageSlotCount() == 3);
+
+	// heap low with nothing loaded yet: only the prefetch slot goes, the screen keeps the two it was allocated with
+	host::heapSize = host::liveBytes + PixelArtClient::heapReserve / 4;
+	for (int i = 0; i < 5; i++)
+		client.loop();
+	assert(screen.imageSlotCount() == 2 && screen.isAllocated());
+	assert(screen.imageSlots[0].arena.bytes() > 0 && screen.imageSlots[1].arena.bytes() > 0);
+
+	// and back once there's room again
+	host::heapSize = host::liveBytes + 4 * PixelArtClient::heapReserve;
+	client.loop();
+	assert(screen.imageSlotCount() == 3);
+
+	// heap low with images waiting: the last in the queue goes, but never one of the first two slots
+	for (uint8_t i = 0; i < 3; i++)
+	{
+		screen.loadingImage = screen.freeImageSlot();
+		screen.loadingImage->beginImage(1, 16, 8);
+		screen.loadingImage->finishImage();
+		screen.imageReceived();
+	}
+	assert(screen.readyCount == 3);
+	host::heapSize = host::liveBytes + PixelArtClient::heapReserve / 4;
+	screen.balancePrefetch();
+	screen.balancePrefetch();
+	assert(screen.imageSlotCount() == 2 && screen.readyCount == 2);
+	assert(screen.imageSlots[0].arena.bytes() > 0 && screen.imageSlots[1].arena.bytes() > 0);
+	screen.readyCount = 0;
+
+	// the heap recovers and the next image is fetched into the screen
+	host::heapSize = host::liveBytes + 4 * PixelArtClient::heapReserve;
+	client.serverUp = true;
+	HostNet::reply(host::binaryResponse(16, 8, "after.gif"));
+	for (int i = 0; i < 200 && !screen.imageLoaded; i++)
+	{
+		client.loop();
+		host::clockOffset += 50;
+	}
+	assert(screen.imageLoaded && screen.imageSlotCount() == 3);
+	assert(screen.currentImage->name == "after.gif" && screen.currentImage->loadedPixel(3, 0).r == 3);
+	puts("prefetch ok");
+	return 0;
+}
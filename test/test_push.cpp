@@ -0,0 +1,62 @@
+// push updates: each screen's topic is subscribed from loop() into a fixed buffer the MQTT task matches against, a
+// changed topic is dropped before the new one goes in, and a push only flags the screen for loop() to act on
+#include "host.h"
+
+int main()
+{
+	host::heapSize = 1 << 20;
+	host::matrix(16, 8);
+	AsyncMqttClient broker;
+	mqtt = &broker;
+	PixelArtClient client;
+	client.enabled = true;
+	client.pushUpdates = true;
+	client.screenIds[0] = "a";
+	client.pixelArtMode = strip.addEffect(255, &PixelArtClient::mode_pixelart, "Pixel Art");
+	strip.getSegment(0).mode = client.pixelArtMode;
+	assert(client.allocateFrameBuffers());
+	char image[] = "image";
+	char other[] = "brightness";
+
+	client.loop();
+	assert(broker.topics == std::set<std::string>{"pixelart/a"} && strcmp(client.pushSubscriptions[0], "pixelart/a") == 0);
+
+	// a push is matched and flagged on the MQTT task, and counted once loop() gets to it
+	char topicA[] = "pixelart/a";
+	assert(client.onMqttMessage(topicA, image) && client.pushReceived[0]);
+	client.loop();
+	assert(!client.pushReceived[0] && client.metrics.pushes == 1);
+	assert(client.onMqttMessage(topicA, other) && !client.pushReceived[0]);
+
+	// a new screen id swaps the subscription, and the old topic matches nothing from then on
+	client.screenIds[0] = "b";
+	client.pushTopicsDirty = true;
+	client.loop();
+	char topicB[] = "pixelart/b";
+	assert(broker.topics == std::set<std::string>{"pixelart/b"});
+	assert(!client.onMqttMessage(topicA, image) && client.onMqttMessage(topicB, image));
+
+	// a push for a screen loop() deleted in the meantime is dropped
+	client.pushReceived[1] = true;
+	client.loop();
+	assert(!client.pushReceived[1] && client.pushReceived[0] == false && client.metrics.pushes == 2);
+
+	// a topic too long for the buffer isn't subscribed to, rather than cut short
+	client.screenIds[0] = std::string(70, 'x').c_str();
+	client.pushTopicsDirty = true;
+	client.loop();
+	assert(broker.topics.empty() && client.pushSubscriptions[0][0] == '\0');
+
+	// a reconnect makes every subscription again
+	client.screenIds[0] = "a";
+	client.pushTopicsDirty = true;
+	client.loop();
+	broker.topics.clear();
+	client.onMqttConnect(false);
+	client.loop();
+	assert(broker.topics == std::set<std::string>{"pixelart/a"});
+
+	mqtt = nullptr;
+	puts("push ok");
+	return 0;
+}
@@ -19,6 +19,13 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <new>
+#ifndef ARDUINO
+#include <sys/stat.h>
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 // Library inclusions.
 /*
@@ -147,392 +154,5965 @@ CRGB flatten(CRGBA &overlay, CRGB &existing)
 	return rCRGB;
 }
 
-// class name. Use something descriptive and leave the ": public Usermod" part :)
-class PixelArtClient : public Usermod
+// blend8 works out to (a * (256 - amount) + b * (amount + 1)) >> 8, weights that never sum past 257.
+// so the kernels below can blend several bytes at once in 16 bit lanes and stay bit-exact with it
+
+/**
+ * blend8 on the four bytes of a and b at once: even and odd bytes go in separate 16 bit lanes,
+ * where a lane's sum is at most 255 * 257 and can't carry into the next
+ */
+inline uint32_t blend8x4(uint32_t a, uint32_t b, uint16_t weightA, uint16_t weightB)
+{
+	const uint32_t evens = (a & 0x00FF00FF) * weightA + (b & 0x00FF00FF) * weightB;
+	const uint32_t odds = ((a >> 8) & 0x00FF00FF) * weightA + ((b >> 8) & 0x00FF00FF) * weightB;
+	return ((evens >> 8) & 0x00FF00FF) | (odds & 0xFF00FF00);
+}
+
+/**
+ * blend8 over every byte of two buffers, a 32 bit word at a time. out may be either input
+ */
+void blendBytesPacked(const uint8_t *from, const uint8_t *to, uint8_t *out, size_t count, fract8 amount)
+{
+	const uint16_t weightA = 256 - amount;
+	const uint16_t weightB = amount + 1;
+	size_t i = 0;
+	for (; i + sizeof(uint32_t) <= count; i += sizeof(uint32_t))
+	{
+		uint32_t a, b;
+		memcpy(&a, from + i, sizeof(a));
+		memcpy(&b, to + i, sizeof(b));
+		const uint32_t blended = blend8x4(a, b, weightA, weightB);
+		memcpy(out + i, &blended, sizeof(blended));
+	}
+	for (; i < count; i++)
+	{
+		out[i] = blend8(from[i], to[i], amount);
+	}
+}
+
+#if defined(__SSE2__)
+/**
+ * the same 16 bytes at a time, for host builds. returns how many bytes it blended, the rest is left to blendBytesPacked
+ */
+size_t blendBytesSse2(const uint8_t *from, const uint8_t *to, uint8_t *out, size_t count, fract8 amount)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i weightA = _mm_set1_epi16(256 - amount);
+	const __m128i weightB = _mm_set1_epi16(amount + 1);
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		const __m128i a = _mm_loadu_si128((const __m128i *)(from + i));
+		const __m128i b = _mm_loadu_si128((const __m128i *)(to + i));
+		// sums reach 65535, which wraps as a signed lane but is the right bits for the logical shift
+		const __m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), weightA), _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), weightB));
+		const __m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), weightA), _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), weightB));
+		_mm_storeu_si128((__m128i *)(out + i), _mm_packus_epi16(_mm_srli_epi16(low, 8), _mm_srli_epi16(high, 8)));
+	}
+	return i;
+}
+#endif
+
+/**
+ * blend a row of CRGBA or CRGB pixels towards another, bit-exact with blend_a / nblend on each channel
+ */
+inline void blendBytes(const uint8_t *from, const uint8_t *to, uint8_t *out, size_t count, fract8 amount)
+{
+	size_t done = 0;
+#if defined(__SSE2__)
+	done = blendBytesSse2(from, to, out, count, amount);
+#endif
+	blendBytesPacked(from + done, to + done, out + done, count - done, amount);
+}
+
+/// How a run of a frame's pixels covers what's under it: not at all, fully, or partly. A run is one byte, the coverage
+/// in the top two bits and up to 64 pixels in the rest. A frame's runs go row by row and each row's add up to its width,
+/// so an overlay can skip what's see-through and only read back the pixels it actually blends.
+struct CoverageRun
+{
+	enum Coverage : uint8_t
+	{
+		CLEAR,
+		OPAQUE,
+		PARTIAL
+	};
+	static const uint8_t maxLength = 64;
+
+	static inline Coverage of(uint8_t alpha) { return alpha == 0 ? CLEAR : (alpha == 255 ? OPAQUE : PARTIAL); }
+	static inline uint8_t encode(Coverage coverage, uint8_t length) { return coverage << 6 | (length - 1); }
+	static inline Coverage coverage(uint8_t run) { return (Coverage)(run >> 6); }
+	static inline uint8_t length(uint8_t run) { return (run & 0x3F) + 1; }
+};
+
+/// Non-owning view of a single frame: `height` rows of `width` pixels, each row `stride` pixels apart.
+/// Pixels are stored as CRGBA, as CRGB once flattened against the background, or as 8-bit indices into a palette.
+/// Copying a view is just copying a pointer, so the draw path can hold and swap them freely.
+struct FrameView
+{
+	const uint8_t *pixels = nullptr;
+	const CRGBA *palette = nullptr;
+	uint16_t width = 0;
+	uint16_t height = 0;
+	uint16_t stride = 0;
+	// bytes per stored pixel: 4 (CRGBA), 3 (flattened CRGB) or 1 (palette index)
+	uint8_t pixelBytes = sizeof(CRGBA);
+	// every pixel was composited onto the image background as it loaded, so all of them are opaque
+	bool flattened = false;
+	// the slot's layoutVersion when this was looked up, the pixels are stale once that moves on
+	uint16_t layout = 0;
+	// the frame's CoverageRuns, nullptr if it has none
+	const uint8_t *spans = nullptr;
+
+	inline bool isValid() const { return pixels != nullptr; }
+
+	inline bool isIndexed() const { return palette != nullptr; }
+
+	/**
+	 * a row of CRGBA pixels. indexed and flattened frames are expanded into `scratch`, which must hold `width` pixels
+	 */
+	inline const CRGBA *row(uint16_t y, CRGBA *scratch) const
+	{
+		const uint8_t *rowPixels = pixels + (size_t)y * stride * pixelBytes;
+		if (palette != nullptr)
+		{
+			for (uint16_t x = 0; x < width; x++)
+			{
+				scratch[x] = palette[rowPixels[x]];
+			}
+			return scratch;
+		}
+		if (pixelBytes == sizeof(CRGBA))
+			return (const CRGBA *)rowPixels;
+
+		const CRGB *colours = (const CRGB *)rowPixels;
+		for (uint16_t x = 0; x < width; x++)
+		{
+			scratch[x] = CRGBA(colours[x].r, colours[x].g, colours[x].b, 255);
+		}
+		return scratch;
+	}
+
+	/**
+	 * a row of a flattened frame, ready to draw. indexed frames are looked up into `scratch`, which must hold `width` pixels
+	 */
+	inline const CRGB *rgbRow(uint16_t y, CRGB *scratch) const
+	{
+		const uint8_t *rowPixels = pixels + (size_t)y * stride * pixelBytes;
+		if (palette == nullptr)
+			return (const CRGB *)rowPixels;
+
+		for (uint16_t x = 0; x < width; x++)
+		{
+			const CRGBA &colour = palette[rowPixels[x]];
+			scratch[x] = CRGB(colour.r, colour.g, colour.b);
+		}
+		return scratch;
+	}
+
+	inline CRGBA pixel(uint16_t x, uint16_t y) const
+	{
+		const uint8_t *stored = pixels + ((size_t)y * stride + x) * pixelBytes;
+		if (palette != nullptr)
+			return palette[*stored];
+		if (pixelBytes == sizeof(CRGBA))
+			return *(const CRGBA *)stored;
+		return CRGBA(stored[0], stored[1], stored[2], 255);
+	}
+};
+
+/// Where each pixel of a segment reads from in a frame: a column and row of the stored image, or -1 where the image
+/// doesn't reach. Built once for each image size, so scaling while drawing is a table lookup per pixel
+struct ScaleMap
 {
+	enum Fit : uint8_t
+	{
+		// all of the image, as big as fits, centred
+		FIT,
+		// the whole segment, as much of the image as fits once it covers it, centred
+		FILL,
+		// the image as it is, centred
+		CENTRE
+	};
+
+	int16_t *columns = nullptr;
+	int16_t *rows = nullptr;
+	// the segment size
+	uint16_t width = 0;
+	uint16_t height = 0;
+	// what the map was last built for
+	uint16_t imageWidth = 0;
+	uint16_t imageHeight = 0;
+	Fit fit = FIT;
+	// the image is the segment's size, so frames draw pixel for pixel without the map
+	bool identity = true;
+
+	~ScaleMap() { release(); }
+
+	bool allocate(uint16_t segmentWidth, uint16_t segmentHeight)
+	{
+		release();
+		columns = (int16_t *)malloc((size_t)segmentWidth * sizeof(int16_t));
+		rows = (int16_t *)malloc((size_t)segmentHeight * sizeof(int16_t));
+		if (columns == nullptr || rows == nullptr)
+		{
+			release();
+			return false;
+		}
+		width = segmentWidth;
+		height = segmentHeight;
+		return true;
+	}
+
+	void release()
+	{
+		free(columns);
+		free(rows);
+		columns = rows = nullptr;
+		width = height = imageWidth = imageHeight = 0;
+		identity = true;
+	}
+
+	/**
+	 * map the segment onto an image of this size, nearest neighbour. does nothing if that's what it's already mapped to
+	 */
+	void build(uint16_t frameWidth, uint16_t frameHeight, Fit mode)
+	{
+		if (frameWidth == imageWidth && frameHeight == imageHeight && mode == fit)
+			return;
+		imageWidth = frameWidth;
+		imageHeight = frameHeight;
+		fit = mode;
+		identity = frameWidth == width && frameHeight == height;
+		if (identity || columns == nullptr || frameWidth == 0 || frameHeight == 0)
+			return;
+
+		// the image's size on the segment: wider images fit to the width and fill to the height, taller ones the other way
+		uint32_t scaledWidth = frameWidth;
+		uint32_t scaledHeight = frameHeight;
+		const bool wider = (uint32_t)frameWidth * height >= (uint32_t)frameHeight * width;
+		if (mode != CENTRE)
+		{
+			if (wider == (mode == FIT))
+			{
+				scaledWidth = width;
+				scaledHeight = max((uint32_t)frameHeight * width / frameWidth, 1U);
+			}
+			else
+			{
+				scaledHeight = height;
+				scaledWidth = max((uint32_t)frameWidth * height / frameHeight, 1U);
+			}
+		}
+		mapAxis(columns, width, frameWidth, scaledWidth);
+		mapAxis(rows, height, frameHeight, scaledHeight);
+	}
 
 private:
-	// Private class members. You can declare variables and functions only accessible to your usermod here
-	bool enabled = false;
-	bool initDone = false;
-	unsigned long refreshTime = 0;
-	unsigned long lastRequestTime = 0;
+	static void mapAxis(int16_t *map, uint16_t length, uint16_t frameLength, uint32_t scaledLength)
+	{
+		// centred, cropping evenly from both sides if it's bigger
+		const int32_t offset = ((int32_t)length - (int32_t)scaledLength) / 2;
+		for (int32_t i = 0; i < length; i++)
+		{
+			const int32_t scaled = i - offset;
+			map[i] = scaled < 0 || scaled >= (int32_t)scaledLength ? -1 : scaled * frameLength / scaledLength;
+		}
+	}
+};
 
-	// set your config variables to their boot default value (this can also be done in readFromConfig() or a constructor if you prefer)
-	String serverName = "https://app.pixelart-exchange.au/";
-	String apiKey = "your_api_key";
-	String clientName = "WLED";
-	bool transparency = false;
-	bool serverUp = false;
-	long unsigned int serverTestRepeatTime = 10;
+inline uint16_t readUint16(const uint8_t *bytes) { return bytes[0] | (bytes[1] << 8); }
 
-	// These config variables have defaults set inside readFromConfig()
-	int testInt;
-	long testLong;
-	int8_t testPins[2];
-	int crossfadeIncrement = 10;
-	int crossfadeFrameRate = 40;
-	std::vector<std::vector<std::vector<CRGBA>>> image1;
-	std::vector<std::vector<std::vector<CRGBA>>> image2;
-	std::vector<int> image1durations;
-	std::vector<int> image2durations;
-
-	std::vector<std::vector<std::vector<CRGBA>>> *currentImage;
-	std::vector<std::vector<std::vector<CRGBA>>> *nextImage;
-	std::vector<int> *nextImageDurations;
-	std::vector<int> *currentImageDurations;
-
-	// need a struct to hold all this (pixels, frameCount, frame timings )
-	int nextImageFrameCount = 1;
-	int currentImageFrameCount = 1;
-	CRGB nextImageBackgroundColour;
-	CRGB currentImageBackgroundColour;
-	int numFrames;
-
-	int currentFrameIndex = 0;
-	// within the image, we may have one or more frames
-	std::vector<std::vector<CRGBA>> currentFrame;
- unsigned int currentFrameDuration;
-	// within the next image,cache the first frame for a transition
-	std::vector<std::vector<CRGBA>> nextFrame;
-	int nextBlend = 0;
+inline void writeUint16(uint8_t *bytes, uint16_t value)
+{
+	bytes[0] = value & 0xFF;
+	bytes[1] = value >> 8;
+}
 
-	// time betwwen images
-	int duration;
-	// in seconds
-	unsigned int imageDuration = 10;
-	bool imageLoaded = false;
-	int imageIndex = 0;
+/// A horizontal run of pixels that changed from one frame to the next
+struct FrameRun
+{
+	uint16_t x;
+	uint16_t y;
+	uint16_t length;
+};
 
-	HTTPClient http;
-	WiFiClient client;
+/// What changed with the last frame flip, read straight out of a delta frame's run headers.
+/// `all` is set when there is nothing to go on, e.g. after a keyframe or a seek.
+struct FrameChanges
+{
+	const uint8_t *runs = nullptr;
+	uint16_t count = 0;
+	bool all = true;
 
-	String playlist;
+	inline FrameRun run(uint16_t index) const
+	{
+		const uint8_t *header = runs + (size_t)index * 6;
+		return FrameRun{readUint16(header), readUint16(header + 2), readUint16(header + 4)};
+	}
+};
+
+/// One contiguous block of memory holding an image slot's stored frames.
+/// It is allocated once for the configured matrix size and then reused for every image loaded into the slot,
+/// so fetching an image never touches the heap.
+class FrameArena
+{
+private:
+	uint8_t *buffer = nullptr;
+	size_t size = 0;
+
+public:
+	~FrameArena() { release(); }
+
+	bool allocate(size_t bytes)
+	{
+		release();
+		if (bytes == 0)
+			return false;
+		buffer = (uint8_t *)malloc(bytes);
+		if (buffer == nullptr)
+			return false;
+		size = bytes;
+		return true;
+	}
+
+	void release()
+	{
+		free(buffer);
+		buffer = nullptr;
+		size = 0;
+	}
+
+	inline uint8_t *data() { return buffer; }
+	inline const uint8_t *data() const { return buffer; }
+	inline size_t bytes() const { return size; }
+};
+
+/// An image slot: the frame arena plus everything needed to play the image back (frame count, timings, background).
+///
+/// Frames are loaded one at a time into a shared staging frame, then committed to the arena either whole (a keyframe)
+/// or as a delta: the runs of pixels that changed since the previous frame. Keyframes every `keyframeInterval` frames
+/// keep seeking and looping cheap. Pixels are CRGBA, or 8-bit indices into a palette of up to 256 colours.
+///
+/// Arena layout per frame, at frameTable[frame]:
+///  - keyframe: width x height pixels
+///  - delta: uint16 run count, then x, y, length (uint16 each) per run, then each run's pixels in order
+///
+/// Frames that keep their alpha also get a list of CoverageRuns, stored down from the top of the arena at spanTable[frame].
+/// They only take room the frames don't need, and are given up if a frame does.
+struct ImageSlot
+{
+	// an indexed pixel is this many times smaller than a CRGBA one
+	static const uint8_t indexedFrameRatio = sizeof(CRGBA);
+	// the frame table holds this many times the configured frames, as palettes and deltas fit far more in the arena
+	static const uint8_t frameTableRatio = 8;
+	static const uint16_t paletteLookupSize = 512;
+	static const uint8_t runHeaderSize = 6;
+	static const uint32_t keyframeFlag = 0x80000000UL;
+	static const uint32_t noSpans = UINT32_MAX;
+	// images more than this many times the slot's size are cut down to it
+	static const uint8_t maxLoadScale = 16;
+
+	FrameArena arena;
+	size_t arenaUsed = 0;
+	// arena offset of each stored frame, with keyframeFlag set on keyframes
+	uint32_t *frameTable = nullptr;
+	// arena offset of each stored frame's coverage runs, or noSpans
+	uint32_t *spanTable = nullptr;
+	// arena bytes taken by the coverage runs, at the top
+	size_t spanBytes = 0;
+	// still working out coverage runs for this image, cleared once frames need their room
+	bool keepSpans = false;
+	uint16_t *durations = nullptr;
+	uint16_t tableCapacity = 0;
+	uint16_t maxWidth = 0;
+	uint16_t maxHeight = 0;
+
+	uint16_t frameCount = 0;
+	// only every frameStride-th frame of the source is kept, when that's what it takes to fit the whole animation
+	uint16_t frameStride = 1;
+	uint16_t width = 0;
+	uint16_t height = 0;
+	// images bigger than the slot are shrunk as they load, each stored pixel the average of loadScale x loadScale
+	// source pixels. the source coordinates run up to sourceWidth x sourceHeight
+	uint8_t loadScale = 1;
+	uint16_t sourceWidth = 0;
+	uint16_t sourceHeight = 0;
+	CRGB backgroundColour;
+	uint8_t pixelBytes = sizeof(CRGBA);
+	// every this many frames is stored whole, 1 turns delta frames off
+	uint8_t keyframeInterval = 8;
+	// for opaque playback: composite each frame onto the background as it loads and store plain CRGB
+	bool flattenOnLoad = false;
+	bool flattened = false;
+
+	// palette mode: frames hold 8-bit indices into up to 256 colours
+	bool indexed = false;
+	uint16_t paletteSize = 0;
+	CRGBA palette[256];
+
+	// playback: delta frames are rebuilt in here
+	uint8_t *working = nullptr;
+	int32_t workingFrame = -1;
+	int32_t shownFrame = -1;
+
+	// loading: frames before loadingFrame are in the arena, loadingFrame itself is in staging
+	uint16_t storedFrames = 0;
+	uint16_t loadingFrame = 0;
+	bool loadingTouched = false;
+	// the source frame whose duration was last set, rows of JSON each repeat it
+	uint16_t durationFrame = UINT16_MAX;
+
+	// how the image was made to fit the arena, for the metrics
+	enum StoragePlan : uint8_t
+	{
+		// as configured
+		AS_REQUESTED,
+		// as palette indices, though palette frames are turned off
+		COMPACT,
+		// keeping every frameStride-th frame
+		SKIP_FRAMES,
+		// ran out of room as it loaded and kept the frames before that
+		TRUNCATED,
+		STORAGE_PLANS
+	};
+	StoragePlan plan = AS_REQUESTED;
+	// set when pixels arrive for a frame already stored. it may be a delta of the frame before, so it can't be
+	// changed, and the image is no good as sent
+	bool outOfOrder = false;
+	// what the server called the image and its ETag, once it has fully loaded. asking again for an image with
+	// the same name or tag gets an unchanged reply instead of the image
 	String name;
+	String tag;
+	// seconds the image stays up, from the playlist manifest. 0 for the client's image duration
+	uint16_t duration = 0;
+	// bumped whenever stored frames move, which can happen under playback while the rest of the image loads
+	uint16_t layoutVersion = 0;
+
+	/// source pixels summed into one stored pixel while an image is shrunk, colours weighted by their alpha
+	struct BoxSum
+	{
+		uint32_t r;
+		uint32_t g;
+		uint32_t b;
+		uint32_t a;
+		uint16_t count;
+	};
 
-	// string that are used multiple time (this will save some flash memory)
-	static const char _name[];
-	static const char _enabled[];
+	// only one image loads at a time, so the frame being loaded, the one before it, the row being shrunk
+	// and the colour -> palette index + 1 lookup are shared by every slot
+	static uint8_t *staging;
+	static uint8_t *reference;
+	static BoxSum *boxSums;
+	static uint16_t paletteLookup[paletteLookupSize];
+	// the source frame and stored row being summed into boxSums, boxRow is -1 when there's nothing in them
+	uint16_t boxFrame = 0;
+	int32_t boxRow = -1;
 
-	// any private methods should go here (non-inline methosd should be defined out of class)
-	void publishMqtt(const char *state, bool retain = false); // example for publishing MQTT message
+	~ImageSlot() { release(); }
 
-public:
-	// non WLED related methods, may be used for data exchange between usermods (non-inline methods should be defined out of class)
+	/**
+	 * the arena holds `frames` full colour frames of the matrix size, more once palettes and deltas shrink them
+	 */
+	bool allocate(uint16_t frames, uint16_t matrixWidth, uint16_t matrixHeight)
+	{
+		release();
+		const size_t frameBytes = (size_t)matrixWidth * matrixHeight * sizeof(CRGBA);
+		tableCapacity = frames * frameTableRatio;
+		frameTable = (uint32_t *)malloc((size_t)tableCapacity * sizeof(uint32_t));
+		spanTable = (uint32_t *)malloc((size_t)tableCapacity * sizeof(uint32_t));
+		durations = (uint16_t *)calloc(tableCapacity, sizeof(uint16_t));
+		working = (uint8_t *)malloc(frameBytes);
+		if (frameTable == nullptr || spanTable == nullptr || durations == nullptr || working == nullptr || !arena.allocate(frames * frameBytes))
+		{
+			release();
+			return false;
+		}
+		maxWidth = matrixWidth;
+		maxHeight = matrixHeight;
+		return true;
+	}
 
 	/**
-	 * Enable/Disable the usermod
+	 * heap taken by allocate() for the same frames and matrix size
 	 */
-	inline void enable(bool enable) { enabled = enable; }
+	static size_t footprint(uint16_t frames, uint16_t matrixWidth, uint16_t matrixHeight)
+	{
+		const size_t frameBytes = (size_t)matrixWidth * matrixHeight * sizeof(CRGBA);
+		return (size_t)frames * frameTableRatio * (2 * sizeof(uint32_t) + sizeof(uint16_t)) + frameBytes + frames * frameBytes;
+	}
+
+	void release()
+	{
+		arena.release();
+		free(frameTable);
+		free(spanTable);
+		free(durations);
+		free(working);
+		frameTable = nullptr;
+		spanTable = nullptr;
+		durations = nullptr;
+		working = nullptr;
+		tableCapacity = 0;
+		frameCount = width = height = 0;
+		storedFrames = 0;
+		maxWidth = maxHeight = 0;
+	}
+
+	static bool allocateLoadBuffers(uint16_t matrixWidth, uint16_t matrixHeight)
+	{
+		releaseLoadBuffers();
+		const size_t frameBytes = (size_t)matrixWidth * matrixHeight * sizeof(CRGBA);
+		staging = (uint8_t *)malloc(frameBytes);
+		reference = (uint8_t *)malloc(frameBytes);
+		boxSums = (BoxSum *)calloc(matrixWidth, sizeof(BoxSum));
+		if (staging == nullptr || reference == nullptr || boxSums == nullptr)
+		{
+			releaseLoadBuffers();
+			return false;
+		}
+		return true;
+	}
+
+	static void releaseLoadBuffers()
+	{
+		free(staging);
+		free(reference);
+		free(boxSums);
+		staging = reference = nullptr;
+		boxSums = nullptr;
+	}
+
+	inline size_t framePixels() const { return (size_t)width * height; }
+	inline size_t frameBytes() const { return framePixels() * pixelBytes; }
+	// full colour frames load as CRGBA and are only flattened as they are committed, once any alpha plane is in
+	inline uint8_t loadPixelBytes() const { return indexed ? 1 : sizeof(CRGBA); }
+	inline uint8_t colourPixelBytes() const { return flattened ? sizeof(CRGB) : sizeof(CRGBA); }
 
 	/**
-	 * Get usermod enabled/disabled state
+	 * source pixels per stored pixel along each side for an image of this size: the smallest whole number that fits
+	 * all of it in the slot
 	 */
-	inline bool isEnabled() { return enabled; }
+	uint8_t fitScale(uint16_t imageWidth, uint16_t imageHeight) const
+	{
+		const int scale = max((imageWidth + maxWidth - 1) / maxWidth, (imageHeight + maxHeight - 1) / maxHeight);
+		return constrain(scale, 1, (int)maxLoadScale);
+	}
 
-	// in such case add the following to another usermod:
-	//  in private vars:
-	//   #ifdef USERMOD_EXAMPLE
-	//   MyExampleUsermod* UM;
-	//   #endif
-	//  in setup()
-	//   #ifdef USERMOD_EXAMPLE
-	//   UM = (MyExampleUsermod*) usermods.lookup(USERMOD_ID_EXAMPLE);
-	//   #endif
-	//  somewhere in loop() or other member method
-	//   #ifdef USERMOD_EXAMPLE
-	//   if (UM != nullptr) isExampleEnabled = UM->isEnabled();
-	//   if (!isExampleEnabled) UM->enable(true);
-	//   #endif
+	/**
+	 * the size an image of this size is stored at, once fitted to the slot
+	 */
+	inline uint16_t fittedWidth(uint16_t imageWidth, uint16_t imageHeight) const
+	{
+		const uint8_t scale = fitScale(imageWidth, imageHeight);
+		return (min(imageWidth, (uint16_t)(maxWidth * scale)) + scale - 1) / scale;
+	}
+
+	inline uint16_t fittedHeight(uint16_t imageWidth, uint16_t imageHeight) const
+	{
+		const uint8_t scale = fitScale(imageWidth, imageHeight);
+		return (min(imageHeight, (uint16_t)(maxHeight * scale)) + scale - 1) / scale;
+	}
+
+	/**
+	 * prepare the slot for a new image, clamping it to the matrix size, or with `shrinkToFit` averaging it down by
+	 * a whole number until it fits. shrinking needs whole pixels set a row at a time, top to bottom.
+	 * with `usePalette` frames are stored as palette indices until the image turns out to have more than 256 colours.
+	 * `paletteToFit` allows them anyway if that's what it takes to fit the image. totalFrames is UINT16_MAX if not known
+	 */
+	void beginImage(uint16_t totalFrames, uint16_t imageWidth, uint16_t imageHeight, bool usePalette = false, bool paletteToFit = false, bool shrinkToFit = false)
+	{
+		indexed = usePalette;
+		flattened = flattenOnLoad;
+		pixelBytes = indexed ? 1 : colourPixelBytes();
+		paletteSize = 0;
+
+		loadScale = shrinkToFit ? fitScale(imageWidth, imageHeight) : 1;
+		sourceWidth = min(imageWidth, (uint16_t)(maxWidth * loadScale));
+		sourceHeight = min(imageHeight, (uint16_t)(maxHeight * loadScale));
+		width = (sourceWidth + loadScale - 1) / loadScale;
+		height = (sourceHeight + loadScale - 1) / loadScale;
+		boxRow = -1;
+		if (loadScale > 1)
+			memset(boxSums, 0, (size_t)width * sizeof(BoxSum));
+		frameStride = 1;
+		plan = AS_REQUESTED;
+		outOfOrder = false;
+		if (totalFrames != UINT16_MAX)
+			planStorage(totalFrames, paletteToFit);
+		frameCount = min((totalFrames + frameStride - 1) / frameStride, (int)tableCapacity);
+		if (indexed)
+			memset(paletteLookup, 0, sizeof(paletteLookup));
+		memset(durations, 0, (size_t)tableCapacity * sizeof(uint16_t));
+		durationFrame = UINT16_MAX;
+
+		arenaUsed = 0;
+		// only an overlay needs to know where the frames are see-through
+		spanBytes = 0;
+		keepSpans = !flattened;
+		storedFrames = 0;
+		loadingFrame = 0;
+		loadingTouched = false;
+		workingFrame = -1;
+		shownFrame = -1;
+		memset(staging, 0, framePixels() * loadPixelBytes());
+	}
+
+	/**
+	 * commit the last frame, after which frameCount is the number of frames actually stored
+	 */
+	void finishImage()
+	{
+		if (boxRow >= 0)
+			flushBox();
+		if (loadingFrame < frameCount && loadingTouched)
+			commitFrame();
+		frameCount = storedFrames;
+	}
+
+	inline bool isLoaded() const { return frameCount > 0; }
+
+	/**
+	 * true if pixels of this source frame are stored, rather than skipped or past what fits
+	 */
+	inline bool keepsFrame(uint16_t frame) const
+	{
+		return frame % frameStride == 0 && frame / frameStride < frameCount;
+	}
+
+	/**
+	 * the display time of a source frame. frames skipped to fit add theirs to the frame kept before them,
+	 * so the animation still runs for as long
+	 */
+	void setDuration(uint16_t frame, uint16_t ms)
+	{
+		const uint16_t kept = frame / frameStride;
+		if (kept >= frameCount || frame == durationFrame)
+			return;
+		durationFrame = frame;
+		durations[kept] = frame % frameStride == 0 ? ms : min(durations[kept] + ms, UINT16_MAX);
+	}
+
+	/**
+	 * frames that can be shown: all of them once loaded, the ones fully arrived while the rest are still loading
+	 */
+	inline uint16_t playableFrames() const { return storedFrames; }
+
+	/**
+	 * stop loading, keeping the frames that fully arrived
+	 */
+	void abandonImage()
+	{
+		boxRow = -1;
+		frameCount = storedFrames;
+		loadingFrame = storedFrames;
+		loadingTouched = false;
+	}
+
+	/**
+	 * take on an image whose frame table, durations, palette and arena were filled in directly, e.g. from the cache
+	 */
+	void adoptImage(uint16_t frames, uint16_t imageWidth, uint16_t imageHeight, bool isIndexed, bool isFlattened, uint16_t colours, size_t used)
+	{
+		indexed = isIndexed;
+		flattened = isFlattened;
+		pixelBytes = indexed ? 1 : colourPixelBytes();
+		paletteSize = colours;
+		width = sourceWidth = imageWidth;
+		height = sourceHeight = imageHeight;
+		loadScale = 1;
+		frameCount = storedFrames = loadingFrame = frames;
+		frameStride = 1;
+		plan = AS_REQUESTED;
+		outOfOrder = false;
+		loadingTouched = false;
+		arenaUsed = used;
+		// coverage runs aren't cached, they're worked out again from the frames
+		spanBytes = 0;
+		keepSpans = !flattened;
+		for (uint16_t frame = 0; frame < frames; frame++)
+		{
+			spanTable[frame] = noSpans;
+			storeSpans(frame, seek(frame).pixels);
+		}
+		workingFrame = -1;
+		shownFrame = -1;
+	}
+
+	/**
+	 * store a pixel of a frame being loaded. frames arrive in order: pixels for a later frame commit the current one,
+	 * pixels for an already committed frame set outOfOrder. the caller keeps x and y inside sourceWidth x sourceHeight
+	 */
+	inline void setPixel(uint16_t frame, uint16_t x, uint16_t y, const CRGBA &colour)
+	{
+		if (loadScale > 1)
+		{
+			addToBox(frame, x, y, colour);
+			return;
+		}
+		if (!prepareFrame(frame))
+			return;
+		storePixel((size_t)y * width + x, colour);
+	}
+
+	/**
+	 * the staging pixel a source pixel lands on, for readers that fill in one channel at a time. an image being shrunk
+	 * keeps the top left pixel of each square, the rest are nullptr, as are indexed frames
+	 */
+	CRGBA *loadPixel(uint16_t frame, uint16_t x, uint16_t y)
+	{
+		if (indexed || x % loadScale != 0 || y % loadScale != 0 || !prepareFrame(frame))
+			return nullptr;
+		return (CRGBA *)staging + (size_t)(y / loadScale) * width + x / loadScale;
+	}
+
+	/**
+	 * start loading a frame even if none of its pixels end up set, e.g. a GIF frame that only holds the last one longer.
+	 * false once the frame is past what fits
+	 */
+	inline bool startFrame(uint16_t frame) { return prepareFrame(frame); }
+
+	/**
+	 * a pixel of the frame being loaded, as it stands so far
+	 */
+	inline CRGBA loadedPixel(uint16_t x, uint16_t y) const
+	{
+		const size_t offset = (size_t)y * width + x;
+		return indexed ? palette[staging[offset]] : ((const CRGBA *)staging)[offset];
+	}
+
+	/**
+	 * the staging row of a full colour frame being loaded, for readers that can fill it directly. nullptr otherwise,
+	 * and while the image is being shrunk
+	 */
+	CRGBA *loadRow(uint16_t frame, uint16_t y)
+	{
+		if (indexed || loadScale > 1 || !prepareFrame(frame))
+			return nullptr;
+		return (CRGBA *)staging + (size_t)y * width;
+	}
+
+	/**
+	 * the frame to display, rebuilding delta frames in the working buffer. keyframes are read in place.
+	 * if `changes` is given it receives the runs that differ from the previously shown frame, where known
+	 */
+	FrameView seek(uint16_t index, FrameChanges *changes = nullptr)
+	{
+		FrameView view;
+		view.palette = indexed ? palette : nullptr;
+		view.width = width;
+		view.height = height;
+		view.stride = width;
+		view.pixelBytes = pixelBytes;
+		view.flattened = flattened;
+		view.layout = layoutVersion;
+		if (changes != nullptr)
+		{
+			changes->all = true;
+			changes->count = 0;
+		}
+		if (index >= storedFrames)
+			return view;
+		if (changes != nullptr && shownFrame == index)
+			changes->all = false;
+		if (spanTable[index] != noSpans)
+			view.spans = arena.data() + spanTable[index];
+
+		const uint32_t entry = frameTable[index];
+		if (entry & keyframeFlag)
+		{
+			view.pixels = arena.data() + (entry & ~keyframeFlag);
+			shownFrame = index;
+			return view;
+		}
+
+		if (workingFrame < 0 || workingFrame >= index || !deltasReach(workingFrame, index))
+		{
+			// start again from the nearest keyframe, frame 0 always is one
+			uint16_t keyframe = index;
+			while (!(frameTable[keyframe] & keyframeFlag))
+			{
+				keyframe--;
+			}
+			memcpy(working, arena.data() + (frameTable[keyframe] & ~keyframeFlag), frameBytes());
+			workingFrame = keyframe;
+		}
+		while (workingFrame < index)
+		{
+			applyDelta(++workingFrame);
+		}
+
+		if (changes != nullptr && shownFrame == index - 1)
+		{
+			const uint8_t *delta = arena.data() + entry;
+			changes->all = false;
+			changes->count = readUint16(delta);
+			changes->runs = delta + 2;
+		}
+		shownFrame = index;
+		view.pixels = working;
+		return view;
+	}
+
+private:
+	/**
+	 * true if every frame after `from` up to `to` is a delta, so they can be applied on top of `from`
+	 */
+	bool deltasReach(uint16_t from, uint16_t to) const
+	{
+		for (uint16_t frame = from + 1; frame <= to; frame++)
+		{
+			if (frameTable[frame] & keyframeFlag)
+				return false;
+		}
+		return true;
+	}
+
+	void applyDelta(uint16_t frame)
+	{
+		const uint8_t *delta = arena.data() + frameTable[frame];
+		const uint16_t runCount = readUint16(delta);
+		const uint8_t *header = delta + 2;
+		const uint8_t *payload = header + (size_t)runCount * runHeaderSize;
+		for (uint16_t i = 0; i < runCount; i++, header += runHeaderSize)
+		{
+			const size_t runBytes = (size_t)readUint16(header + 4) * pixelBytes;
+			memcpy(working + ((size_t)readUint16(header + 2) * width + readUint16(header)) * pixelBytes, payload, runBytes);
+			payload += runBytes;
+		}
+	}
+
+	/**
+	 * the least arena an image could take keeping every `stride`-th of its frames: its keyframes, and an empty delta
+	 * for each of the rest. with deltas off this is exactly what it takes
+	 */
+	size_t leastBytes(uint16_t totalFrames, uint16_t stride, uint8_t bytesPerPixel) const
+	{
+		const size_t kept = (totalFrames + stride - 1) / stride;
+		const size_t keyframes = (kept + keyframeInterval - 1) / keyframeInterval;
+		return keyframes * framePixels() * bytesPerPixel + (kept - keyframes) * 2;
+	}
+
+	/**
+	 * admission check, before any of the image loads. if full colour frames could overflow the arena and palette
+	 * indices are allowed, use those (lossless, and still full colour if the image has more than 256). if even the
+	 * keyframes can't fit, keep every frameStride-th frame so the whole animation plays at a lower frame rate,
+	 * rather than only its start. anything past this is cut short as it loads
+	 */
+	void planStorage(uint16_t totalFrames, bool paletteToFit)
+	{
+		if (!indexed && paletteToFit && (size_t)totalFrames * framePixels() * pixelBytes > arena.bytes())
+		{
+			indexed = true;
+			pixelBytes = 1;
+			plan = COMPACT;
+			Serial.println("image too big for full colour frames, storing palette indices");
+		}
+		while (frameStride < totalFrames && ((totalFrames + frameStride - 1) / frameStride > tableCapacity || leastBytes(totalFrames, frameStride, pixelBytes) > arena.bytes()))
+		{
+			frameStride++;
+		}
+		if (frameStride > 1)
+		{
+			plan = SKIP_FRAMES;
+			Serial.print("image too big to store every frame, keeping 1 in ");
+			Serial.println(frameStride);
+		}
+	}
+
+	/**
+	 * write a pixel into the staging frame, as a palette index while the image still fits one
+	 */
+	inline void storePixel(size_t offset, const CRGBA &colour)
+	{
+		if (indexed)
+		{
+			// flattening first can only merge colours, so it goes before the palette
+			const int index = paletteIndex(flattened ? flattenedColour(colour) : colour);
+			if (index >= 0)
+			{
+				staging[offset] = index;
+				return;
+			}
+			// out of palette entries, switch this image to full colour
+			expandPalette();
+			// frameCount can shrink if the bigger frames no longer fit
+			if (loadingFrame >= frameCount)
+				return;
+		}
+		((CRGBA *)staging)[offset] = colour;
+	}
+
+	/**
+	 * add a source pixel to the stored pixel it shrinks into. the row is stored once pixels move on to another
+	 */
+	void addToBox(uint16_t frame, uint16_t x, uint16_t y, const CRGBA &colour)
+	{
+		const int32_t row = y / loadScale;
+		if (boxRow >= 0 && (frame != boxFrame || row != boxRow))
+			flushBox();
+		if (!prepareFrame(frame))
+			return;
+		boxFrame = frame;
+		boxRow = row;
+		// weighted by alpha, so transparent pixels don't darken the edges of what's next to them
+		BoxSum &sum = boxSums[x / loadScale];
+		sum.r += colour.r * colour.a;
+		sum.g += colour.g * colour.a;
+		sum.b += colour.b * colour.a;
+		sum.a += colour.a;
+		sum.count++;
+	}
+
+	/**
+	 * store the averages of the row being shrunk into the frame being loaded
+	 */
+	void flushBox()
+	{
+		const size_t rowOffset = (size_t)boxRow * width;
+		for (uint16_t x = 0; x < width && loadingFrame < frameCount; x++)
+		{
+			const BoxSum &sum = boxSums[x];
+			if (sum.count == 0)
+				continue;
+			if (sum.a == 0)
+				storePixel(rowOffset + x, CRGBA(0, 0, 0, 0));
+			else
+				storePixel(rowOffset + x, CRGBA(sum.r / sum.a, sum.g / sum.a, sum.b / sum.a, sum.a / sum.count));
+		}
+		memset(boxSums, 0, (size_t)width * sizeof(BoxSum));
+		boxRow = -1;
+	}
+
+	bool prepareFrame(uint16_t frame)
+	{
+		// frames skipped to make the image fit are dropped whole
+		if (frame % frameStride != 0)
+			return false;
+		frame /= frameStride;
+		if (frame < loadingFrame)
+		{
+			outOfOrder = true;
+			return false;
+		}
+		if (frame >= frameCount)
+		{
+			plan = TRUNCATED;
+			return false;
+		}
+		while (loadingFrame < frame)
+		{
+			if (!commitFrame())
+				return false;
+		}
+		loadingTouched = true;
+		return true;
+	}
+
+	inline CRGBA flattenedColour(const CRGBA &colour)
+	{
+		CRGBA overlay = colour;
+		const CRGB opaque = flatten(overlay, backgroundColour);
+		return CRGBA(opaque.r, opaque.g, opaque.b, 255);
+	}
+
+	/**
+	 * composite the CRGBA staging frame onto the background, packing it down to CRGB in place
+	 */
+	void flattenStaging()
+	{
+		const size_t pixels = framePixels();
+		CRGB *packed = (CRGB *)staging;
+		for (size_t i = 0; i < pixels; i++)
+		{
+			CRGBA overlay = ((CRGBA *)staging)[i];
+			packed[i] = flatten(overlay, backgroundColour);
+		}
+	}
+
+	/**
+	 * the reverse for the next frame to load over: CRGB back out to opaque CRGBA, in place from the back
+	 */
+	void unpackStaging()
+	{
+		const CRGB *packed = (const CRGB *)staging;
+		for (size_t i = framePixels(); i-- > 0;)
+		{
+			const CRGB colour = packed[i];
+			((CRGBA *)staging)[i] = CRGBA(colour.r, colour.g, colour.b, 255);
+		}
+	}
+
+	inline bool pixelChanged(size_t offset) const
+	{
+		return memcmp(staging + offset * pixelBytes, reference + offset * pixelBytes, pixelBytes) != 0;
+	}
+
+	/**
+	 * find the runs of pixels that differ between reference and staging, merging runs separated by gaps
+	 * cheaper to copy than a new run header. with `out` set, writes them as a delta frame of `runCount` runs,
+	 * otherwise just counts them into `runCount`. returns the size of the delta frame in bytes
+	 */
+	size_t encodeDelta(uint8_t *out, uint16_t &runCount)
+	{
+		const uint16_t mergeGap = runHeaderSize / pixelBytes;
+		uint8_t *header = out ? out + 2 : nullptr;
+		uint8_t *payload = out ? out + 2 + (size_t)runCount * runHeaderSize : nullptr;
+		uint16_t runs = 0;
+		size_t payloadBytes = 0;
+
+		for (uint16_t y = 0; y < height; y++)
+		{
+			const size_t rowStart = (size_t)y * width;
+			int32_t runStart = -1;
+			int32_t lastChanged = -1;
+			for (uint16_t x = 0; x <= width; x++)
+			{
+				const bool changed = x < width && pixelChanged(rowStart + x);
+				if (runStart >= 0 && (x == width || (changed && x - lastChanged - 1 > mergeGap)))
+				{
+					// close the current run
+					const uint16_t length = lastChanged - runStart + 1;
+					if (out != nullptr)
+					{
+						writeUint16(header, runStart);
+						writeUint16(header + 2, y);
+						writeUint16(header + 4, length);
+						header += runHeaderSize;
+						memcpy(payload, staging + (rowStart + runStart) * pixelBytes, (size_t)length * pixelBytes);
+						payload += (size_t)length * pixelBytes;
+					}
+					runs++;
+					payloadBytes += (size_t)length * pixelBytes;
+					runStart = -1;
+				}
+				if (changed)
+				{
+					if (runStart < 0)
+						runStart = x;
+					lastChanged = x;
+				}
+			}
+		}
+
+		if (out != nullptr)
+			writeUint16(out, runs);
+		runCount = runs;
+		return 2 + (size_t)runs * runHeaderSize + payloadBytes;
+	}
+
+	/**
+	 * move the staging frame into the arena, as a delta against the previous frame where that is smaller.
+	 * false if the arena is full, in which case the image ends at the frames stored so far
+	 */
+	bool commitFrame()
+	{
+		const bool flattenFrame = flattened && !indexed;
+		if (flattenFrame)
+			flattenStaging();
+		const size_t fullSize = frameBytes();
+		uint16_t runCount = 0;
+		size_t frameSize = fullSize;
+		bool keyframe = (loadingFrame % keyframeInterval) == 0;
+		if (!keyframe)
+		{
+			frameSize = encodeDelta(nullptr, runCount);
+			if (frameSize >= fullSize)
+			{
+				keyframe = true;
+				frameSize = fullSize;
+			}
+		}
+
+		// frames come first, the coverage runs give up their room if it's needed
+		if (spanBytes > 0 && arenaUsed + frameSize > arena.bytes() - spanBytes)
+			dropSpans();
+		if (arenaUsed + frameSize > arena.bytes())
+		{
+			Serial.print("frame buffer full, keeping ");
+			Serial.print(storedFrames);
+			Serial.print(" of ");
+			Serial.print(frameCount);
+			Serial.println(" frames");
+			frameCount = storedFrames;
+			plan = TRUNCATED;
+			return false;
+		}
+
+		uint8_t *destination = arena.data() + arenaUsed;
+		if (keyframe)
+			memcpy(destination, staging, fullSize);
+		else
+			encodeDelta(destination, runCount);
+		frameTable[loadingFrame] = arenaUsed | (keyframe ? keyframeFlag : 0);
+		arenaUsed += frameSize;
+		// staging still holds the whole frame, even when it was stored as a delta
+		storeSpans(loadingFrame, staging);
+		storedFrames++;
+		loadingFrame++;
+		loadingTouched = false;
+
+		// the next frame is diffed against this one, and starts out as a copy of it
+		uint8_t *previous = reference;
+		reference = staging;
+		staging = previous;
+		memcpy(staging, reference, fullSize);
+		if (flattenFrame)
+			unpackStaging();
+		return true;
+	}
+
+	inline uint8_t storedAlpha(const uint8_t *row, uint16_t x) const
+	{
+		if (indexed)
+			return palette[row[x]].a;
+		return pixelBytes == sizeof(CRGBA) ? row[x * sizeof(CRGBA) + 3] : 255;
+	}
+
+	/**
+	 * split each row of a frame into CoverageRuns. with `out` set writes them there, either way returns their size in bytes
+	 */
+	size_t encodeSpans(const uint8_t *pixels, uint8_t *out) const
+	{
+		size_t bytes = 0;
+		for (uint16_t y = 0; y < height; y++)
+		{
+			const uint8_t *row = pixels + (size_t)y * width * pixelBytes;
+			uint16_t x = 0;
+			while (x < width)
+			{
+				const CoverageRun::Coverage coverage = CoverageRun::of(storedAlpha(row, x));
+				uint8_t length = 1;
+				while (x + length < width && length < CoverageRun::maxLength && CoverageRun::of(storedAlpha(row, x + length)) == coverage)
+				{
+					length++;
+				}
+				if (out != nullptr)
+					out[bytes] = CoverageRun::encode(coverage, length);
+				bytes++;
+				x += length;
+			}
+		}
+		return bytes;
+	}
+
+	/**
+	 * work out a stored frame's coverage runs, if they fit in the room the frames leave
+	 */
+	void storeSpans(uint16_t frame, const uint8_t *pixels)
+	{
+		spanTable[frame] = noSpans;
+		if (!keepSpans)
+			return;
+		const size_t bytes = encodeSpans(pixels, nullptr);
+		if (arenaUsed + spanBytes + bytes > arena.bytes())
+			return;
+		spanBytes += bytes;
+		spanTable[frame] = arena.bytes() - spanBytes;
+		encodeSpans(pixels, arena.data() + spanTable[frame]);
+	}
+
+	/**
+	 * give the coverage runs' room back to the frames. frames shown from here on are drawn a pixel at a time
+	 */
+	void dropSpans()
+	{
+		for (uint16_t frame = 0; frame < storedFrames; frame++)
+		{
+			spanTable[frame] = noSpans;
+		}
+		spanBytes = 0;
+		keepSpans = false;
+		// views handed out still point at them
+		layoutVersion++;
+	}
+
+	/**
+	 * size of a stored frame in the arena
+	 */
+	size_t storedSize(uint16_t frame) const
+	{
+		const size_t end = frame + 1 < storedFrames ? (frameTable[frame + 1] & ~keyframeFlag) : arenaUsed;
+		return end - (frameTable[frame] & ~keyframeFlag);
+	}
+
+	/**
+	 * convert everything loaded so far from palette indices to full colour, dropping frames that no longer fit.
+	 * frames are grown in place from the back, so each one only ever moves into space that has already been read
+	 */
+	void expandPalette()
+	{
+		if (!indexed)
+			return;
+
+		const uint8_t expandedBytes = colourPixelBytes();
+		// work out where the grown frames end up
+		size_t grownUsed = 0;
+		uint16_t keptFrames = 0;
+		for (uint16_t frame = 0; frame < storedFrames; frame++)
+		{
+			const size_t size = storedSize(frame);
+			const size_t headerSize = (frameTable[frame] & keyframeFlag) ? 0 : 2 + (size_t)readUint16(arena.data() + frameTable[frame]) * runHeaderSize;
+			const size_t grownSize = headerSize + (size - headerSize) * expandedBytes;
+			if (grownUsed + grownSize > arena.bytes())
+				break;
+			grownUsed += grownSize;
+			keptFrames++;
+		}
+
+		size_t grownEnd = grownUsed;
+		// the frame table is rewritten as we go, so track where each frame ended before
+		size_t end = keptFrames < storedFrames ? (frameTable[keptFrames] & ~keyframeFlag) : arenaUsed;
+		for (uint16_t frame = keptFrames; frame-- > 0;)
+		{
+			const bool keyframe = frameTable[frame] & keyframeFlag;
+			const size_t offset = frameTable[frame] & ~keyframeFlag;
+			const size_t size = end - offset;
+			const size_t headerSize = keyframe ? 0 : 2 + (size_t)readUint16(arena.data() + offset) * runHeaderSize;
+			const size_t pixels = size - headerSize;
+			const size_t grownOffset = grownEnd - headerSize - pixels * expandedBytes;
+
+			const uint8_t *indices = arena.data() + offset + headerSize;
+			uint8_t *expanded = arena.data() + grownOffset + headerSize;
+			for (size_t i = pixels; i-- > 0;)
+			{
+				memcpy(expanded + i * expandedBytes, palette[indices[i]].raw, expandedBytes);
+			}
+			memmove(arena.data() + grownOffset, arena.data() + offset, headerSize);
+
+			frameTable[frame] = grownOffset | (keyframe ? keyframeFlag : 0);
+			grownEnd = grownOffset;
+			end = offset;
+		}
+
+		// the frames in flight grow the same way, the one loading to CRGBA until it is committed
+		for (size_t i = framePixels(); i-- > 0;)
+		{
+			((CRGBA *)staging)[i] = palette[staging[i]];
+			memcpy(reference + i * expandedBytes, palette[reference[i]].raw, expandedBytes);
+		}
+
+		if (grownUsed > arena.bytes() - spanBytes)
+			dropSpans();
+		// nothing printed here, this runs mid-load. frames given up show in the metrics as a TRUNCATED plan
+		if (keptFrames < storedFrames)
+		{
+			storedFrames = keptFrames;
+			frameCount = keptFrames;
+			plan = TRUNCATED;
+		}
+		arenaUsed = grownUsed;
+		indexed = false;
+		pixelBytes = expandedBytes;
+		workingFrame = -1;
+		shownFrame = -1;
+		layoutVersion++;
+	}
+
+	/**
+	 * find or add the colour in the palette, -1 when it is full
+	 */
+	int paletteIndex(const CRGBA &colour)
+	{
+		uint32_t packed;
+		memcpy(&packed, colour.raw, sizeof(packed));
+		uint16_t slot = (packed * 2654435761UL) >> 23;
+		while (true)
+		{
+			slot &= paletteLookupSize - 1;
+			const uint16_t entry = paletteLookup[slot];
+			if (entry == 0)
+				break;
+			if (memcmp(palette[entry - 1].raw, colour.raw, sizeof(CRGBA)) == 0)
+				return entry - 1;
+			slot++;
+		}
+
+		if (paletteSize == 256)
+			return -1;
+		palette[paletteSize] = colour;
+		paletteLookup[slot] = ++paletteSize;
+		return paletteSize - 1;
+	}
+};
+
+uint8_t *ImageSlot::staging = nullptr;
+uint8_t *ImageSlot::reference = nullptr;
+ImageSlot::BoxSum *ImageSlot::boxSums = nullptr;
+uint16_t ImageSlot::paletteLookup[ImageSlot::paletteLookupSize];
+
+/// Somewhere to keep cached images by name. The device keeps them on the WLED filesystem,
+/// a host build can point a DirectoryCacheStore at a plain directory instead.
+class CacheStore
+{
+public:
+	virtual ~CacheStore() {}
+
+	virtual bool begin() = 0;
+
+	/**
+	 * size of the named entry in bytes, 0 if there is no such entry
+	 */
+	virtual size_t size(const char *name) = 0;
+
+	/**
+	 * read up to `length` bytes from `offset`, returning how many were read
+	 */
+	virtual size_t read(const char *name, size_t offset, uint8_t *data, size_t length) = 0;
+
+	/**
+	 * start a new entry with `data`, or with `append` add it to the end of an existing one
+	 */
+	virtual bool write(const char *name, const uint8_t *data, size_t length, bool append) = 0;
+
+	virtual bool remove(const char *name) = 0;
+};
+
+/// Cache entries as files in a directory of the WLED filesystem
+class FileSystemCacheStore : public CacheStore
+{
+private:
+	const char *directory;
+
+	String pathFor(const char *name) const { return String(directory) + "/" + name; }
+
+public:
+	FileSystemCacheStore(const char *cacheDirectory) : directory(cacheDirectory) {}
+
+	bool begin() override
+	{
+		return WLED_FS.exists(directory) || WLED_FS.mkdir(directory);
+	}
+
+	size_t size(const char *name) override
+	{
+		const String path = pathFor(name);
+		if (!WLED_FS.exists(path))
+			return 0;
+		File file = WLED_FS.open(path, "r");
+		if (!file)
+			return 0;
+		const size_t fileSize = file.size();
+		file.close();
+		return fileSize;
+	}
+
+	size_t read(const char *name, size_t offset, uint8_t *data, size_t length) override
+	{
+		File file = WLED_FS.open(pathFor(name), "r");
+		if (!file)
+			return 0;
+		size_t count = 0;
+		if (file.seek(offset))
+			count = file.read(data, length);
+		file.close();
+		return count;
+	}
+
+	bool write(const char *name, const uint8_t *data, size_t length, bool append) override
+	{
+		File file = WLED_FS.open(pathFor(name), append ? "a" : "w");
+		if (!file)
+			return false;
+		const size_t count = file.write(data, length);
+		file.close();
+		return count == length;
+	}
+
+	bool remove(const char *name) override
+	{
+		return WLED_FS.remove(pathFor(name));
+	}
+};
+
+#ifndef ARDUINO
+/// Cache entries as files in a plain directory, so the cache can be run on a host
+class DirectoryCacheStore : public CacheStore
+{
+private:
+	String directory;
+
+	String pathFor(const char *name) const { return directory + "/" + name; }
+
+public:
+	DirectoryCacheStore(const char *cacheDirectory) : directory(cacheDirectory) {}
+
+	bool begin() override
+	{
+		mkdir(directory.c_str(), 0755);
+		struct stat info;
+		return stat(directory.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+	}
+
+	size_t size(const char *name) override
+	{
+		struct stat info;
+		return stat(pathFor(name).c_str(), &info) == 0 ? info.st_size : 0;
+	}
+
+	size_t read(const char *name, size_t offset, uint8_t *data, size_t length) override
+	{
+		FILE *file = fopen(pathFor(name).c_str(), "rb");
+		if (file == nullptr)
+			return 0;
+		size_t count = 0;
+		if (fseek(file, offset, SEEK_SET) == 0)
+			count = fread(data, 1, length, file);
+		fclose(file);
+		return count;
+	}
+
+	bool write(const char *name, const uint8_t *data, size_t length, bool append) override
+	{
+		FILE *file = fopen(pathFor(name).c_str(), append ? "ab" : "wb");
+		if (file == nullptr)
+			return false;
+		const size_t count = fwrite(data, 1, length, file);
+		return fclose(file) == 0 && count == length;
+	}
+
+	bool remove(const char *name) override
+	{
+		return ::remove(pathFor(name).c_str()) == 0;
+	}
+};
+#endif
+
+/// Decoded images kept in a CacheStore, so an image that comes round again is read back instead of downloaded.
+/// Entries are keyed by the image path and the size it was requested at, and the least recently used ones are
+/// evicted to keep the cache inside its byte budget. An entry is the slot's own storage (frame table, durations,
+/// palette and arena) written out as is, so it is only ever read back by the build that wrote it. Saving is written a
+/// piece at a time by saveNext(), one call per loop(), so a big image doesn't hold the display up for a flash write
+/// of all of it.
+class ImageCache
+{
+public:
+	static const uint8_t maxEntries = 32;
+
+private:
+	struct Entry
+	{
+		uint32_t key;
+		uint32_t size;
+		uint32_t lastUsed;
+	};
+
+	struct EntryHeader
+	{
+		char magic[4];
+		uint16_t width;
+		uint16_t height;
+		uint16_t frames;
+		uint16_t paletteSize;
+		uint32_t arenaUsed;
+		uint8_t background[3];
+		uint8_t indexed;
+		uint8_t flattened;
+		uint8_t nameLength;
+	};
+
+	// what the next saveNext() writes
+	enum SaveStep : uint8_t
+	{
+		SAVE_ROOM,
+		SAVE_DURATIONS,
+		SAVE_FRAMES,
+		SAVE_PALETTE,
+		SAVE_ARENA,
+		SAVE_INDEX
+	};
+
+	static constexpr const char *indexName = "index";
+	static constexpr const char *entryMagic = "PXC2";
+	// the most of the arena written in one step
+	static constexpr size_t saveChunk = 4096;
+
+	CacheStore &store;
+	Entry entries[maxEntries];
+	uint8_t entryCount = 0;
+	// bumped on every use, the entry with the lowest lastUsed goes first
+	uint32_t useClock = 0;
+	size_t budget = 0;
+	bool ready = false;
+
+	// the image being saved, nullptr if none, and how far it's got
+	const ImageSlot *saving = nullptr;
+	uint32_t savingKey = 0;
+	uint32_t savingSize = 0;
+	EntryHeader savingHeader;
+	SaveStep saveStep = SAVE_ROOM;
+	size_t arenaSaved = 0;
+
+public:
+	ImageCache(CacheStore &cacheStore) : store(cacheStore) {}
+
+	/**
+	 * read the index back from the store. a budget of 0 turns the cache off
+	 */
+	void begin(size_t budgetBytes)
+	{
+		cancelSave();
+		budget = budgetBytes;
+		entryCount = 0;
+		useClock = 0;
+		ready = budget > 0 && store.begin();
+		if (!ready)
+			return;
+
+		const size_t indexSize = store.size(indexName);
+		if (indexSize % sizeof(Entry) == 0 && indexSize <= sizeof(entries))
+			entryCount = store.read(indexName, 0, (uint8_t *)entries, indexSize) / sizeof(Entry);
+		for (uint8_t i = 0; i < entryCount; i++)
+		{
+			useClock = max(useClock, entries[i].lastUsed);
+		}
+		// the budget may have shrunk since the index was written
+		if (makeRoom(0))
+			writeIndex();
+	}
+
+	inline bool isEnabled() const { return ready; }
+	inline uint8_t count() const { return entryCount; }
+
+	size_t bytesUsed() const
+	{
+		size_t total = 0;
+		for (uint8_t i = 0; i < entryCount; i++)
+		{
+			total += entries[i].size;
+		}
+		return total;
+	}
+
+	/**
+	 * FNV-1a over the image path and the size it was requested at
+	 */
+	static uint32_t keyFor(const String &path, uint16_t width, uint16_t height)
+	{
+		uint32_t hash = 2166136261UL;
+		const uint8_t size[4] = {(uint8_t)width, (uint8_t)(width >> 8), (uint8_t)height, (uint8_t)(height >> 8)};
+		for (unsigned int i = 0; i < path.length(); i++)
+		{
+			hash = (hash ^ (uint8_t)path[i]) * 16777619UL;
+		}
+		for (uint8_t i = 0; i < sizeof(size); i++)
+		{
+			hash = (hash ^ size[i]) * 16777619UL;
+		}
+		return hash;
+	}
+
+	/**
+	 * load a cached image into the slot, false if it isn't cached or doesn't fit the slot
+	 */
+	bool load(uint32_t key, ImageSlot &slot, String &imageName)
+	{
+		const int index = find(key);
+		if (index < 0)
+			return false;
+
+		char name[16];
+		entryName(key, name);
+		EntryHeader header;
+		size_t offset = 0;
+		if (!readPart(name, offset, &header, sizeof(header)) || memcmp(header.magic, entryMagic, 4) != 0)
+		{
+			evict(index);
+			writeIndex();
+			return false;
+		}
+		// cached for a bigger matrix or more frames than the slot has room for now, or flattened when that's not wanted.
+		// downloading it again replaces the entry
+		if (header.flattened != slot.flattenOnLoad || header.frames > slot.tableCapacity || header.width > slot.maxWidth || header.height > slot.maxHeight || header.arenaUsed > slot.arena.bytes() || header.paletteSize > 256)
+			return false;
+
+		char path[256];
+		bool complete = readPart(name, offset, path, header.nameLength);
+		path[header.nameLength] = '\0';
+		complete = complete && readPart(name, offset, slot.durations, (size_t)header.frames * sizeof(uint16_t));
+		complete = complete && readPart(name, offset, slot.frameTable, (size_t)header.frames * sizeof(uint32_t));
+		complete = complete && readPart(name, offset, slot.palette, (size_t)header.paletteSize * sizeof(CRGBA));
+		complete = complete && readPart(name, offset, slot.arena.data(), header.arenaUsed);
+		if (!complete)
+		{
+			slot.frameCount = 0;
+			evict(index);
+			writeIndex();
+			return false;
+		}
+
+		slot.backgroundColour = CRGB(header.background[0], header.background[1], header.background[2]);
+		slot.adoptImage(header.frames, header.width, header.height, header.indexed, header.flattened, header.paletteSize, header.arenaUsed);
+		imageName = String(path);
+		// only held in memory until the next save, rather than writing the index out on every hit
+		entries[index].lastUsed = ++useClock;
+		return true;
+	}
+
+	inline bool isSaving() const { return saving != nullptr; }
+
+	/**
+	 * start caching a completely loaded image under its own name, written out by saveNext(). nothing is written yet,
+	 * false if it can't be cached
+	 */
+	bool beginSave(uint32_t key, const ImageSlot &slot)
+	{
+		cancelSave();
+		if (!ready || !slot.isLoaded())
+			return false;
+
+		EntryHeader &header = savingHeader;
+		memcpy(header.magic, entryMagic, 4);
+		header.width = slot.width;
+		header.height = slot.height;
+		header.frames = slot.frameCount;
+		header.paletteSize = slot.indexed ? slot.paletteSize : 0;
+		header.arenaUsed = slot.arenaUsed;
+		header.background[0] = slot.backgroundColour.r;
+		header.background[1] = slot.backgroundColour.g;
+		header.background[2] = slot.backgroundColour.b;
+		header.indexed = slot.indexed;
+		header.flattened = slot.flattened;
+		header.nameLength = min(slot.name.length(), (unsigned int)255);
+		const size_t size = sizeof(header) + header.nameLength + (size_t)header.frames * (sizeof(uint16_t) + sizeof(uint32_t)) + (size_t)header.paletteSize * sizeof(CRGBA) + header.arenaUsed;
+		if (size > budget)
+			return false;
+
+		saving = &slot;
+		savingKey = key;
+		savingSize = size;
+		saveStep = SAVE_ROOM;
+		arenaSaved = 0;
+		return true;
+	}
+
+	/**
+	 * write the next piece of the image being saved: an evicted entry, the header and name, the durations, frame
+	 * table, palette, up to saveChunk of the arena, and last the index. false once there's nothing more to do. a slot
+	 * given up part way through is dropped along with what was written of it
+	 */
+	bool saveNext()
+	{
+		if (saving == nullptr)
+			return false;
+		if (!saving->isLoaded())
+		{
+			cancelSave();
+			return false;
+		}
+
+		char name[16];
+		entryName(savingKey, name);
+		const EntryHeader &header = savingHeader;
+		bool written = true;
+		switch (saveStep)
+		{
+		case SAVE_ROOM:
+		{
+			// an older copy of this image first, then the least recently used, one a step
+			const int existing = find(savingKey);
+			if (existing >= 0)
+			{
+				evict(existing);
+				return true;
+			}
+			if (evictOldest(savingSize))
+				return true;
+			written = store.write(name, (const uint8_t *)&header, sizeof(header), false);
+			written = written && store.write(name, (const uint8_t *)saving->name.c_str(), header.nameLength, true);
+			saveStep = SAVE_DURATIONS;
+			break;
+		}
+		case SAVE_DURATIONS:
+			written = store.write(name, (const uint8_t *)saving->durations, (size_t)header.frames * sizeof(uint16_t), true);
+			saveStep = SAVE_FRAMES;
+			break;
+		case SAVE_FRAMES:
+			written = store.write(name, (const uint8_t *)saving->frameTable, (size_t)header.frames * sizeof(uint32_t), true);
+			saveStep = header.paletteSize > 0 ? SAVE_PALETTE : SAVE_ARENA;
+			break;
+		case SAVE_PALETTE:
+			written = store.write(name, (const uint8_t *)saving->palette, (size_t)header.paletteSize * sizeof(CRGBA), true);
+			saveStep = SAVE_ARENA;
+			break;
+		case SAVE_ARENA:
+		{
+			const size_t length = min((size_t)header.arenaUsed - arenaSaved, saveChunk);
+			written = length == 0 || store.write(name, saving->arena.data() + arenaSaved, length, true);
+			arenaSaved += length;
+			if (arenaSaved == header.arenaUsed)
+				saveStep = SAVE_INDEX;
+			break;
+		}
+		case SAVE_INDEX:
+			entries[entryCount++] = Entry{savingKey, savingSize, ++useClock};
+			writeIndex();
+			saving = nullptr;
+			return false;
+		}
+
+		if (!written)
+		{
+			store.remove(name);
+			saving = nullptr;
+			writeIndex();
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * give up the image being saved, removing what was written of it
+	 */
+	void cancelSave()
+	{
+		if (saving == nullptr)
+			return;
+		saving = nullptr;
+		if (saveStep == SAVE_ROOM)
+			return;
+		char name[16];
+		entryName(savingKey, name);
+		store.remove(name);
+	}
+
+	void clear()
+	{
+		cancelSave();
+		while (entryCount > 0)
+		{
+			evict(entryCount - 1);
+		}
+		writeIndex();
+	}
+
+private:
+	int find(uint32_t key) const
+	{
+		for (uint8_t i = 0; i < entryCount; i++)
+		{
+			if (entries[i].key == key)
+				return i;
+		}
+		return -1;
+	}
+
+	static void entryName(uint32_t key, char *name)
+	{
+		snprintf(name, 16, "%08lx.pxc", (unsigned long)key);
+	}
+
+	bool readPart(const char *name, size_t &offset, void *data, size_t length)
+	{
+		if (length > 0 && store.read(name, offset, (uint8_t *)data, length) != length)
+			return false;
+		offset += length;
+		return true;
+	}
+
+	void evict(uint8_t index)
+	{
+		char name[16];
+		entryName(entries[index].key, name);
+		store.remove(name);
+		entries[index] = entries[--entryCount];
+	}
+
+	/**
+	 * evict the least recently used entry if `bytes` more don't fit in the budget and the index, true if one went
+	 */
+	bool evictOldest(size_t bytes)
+	{
+		if (entryCount == 0 || (bytesUsed() + bytes <= budget && (bytes == 0 || entryCount < maxEntries)))
+			return false;
+		uint8_t oldest = 0;
+		for (uint8_t i = 1; i < entryCount; i++)
+		{
+			if (entries[i].lastUsed < entries[oldest].lastUsed)
+				oldest = i;
+		}
+		evict(oldest);
+		return true;
+	}
+
+	/**
+	 * evict least recently used entries until `bytes` more fit, true if any went
+	 */
+	bool makeRoom(size_t bytes)
+	{
+		bool evicted = false;
+		while (evictOldest(bytes))
+		{
+			evicted = true;
+		}
+		return evicted;
+	}
+
+	void writeIndex()
+	{
+		store.write(indexName, (const uint8_t *)entries, (size_t)entryCount * sizeof(Entry), false);
+	}
+};
+
+CRGB hexToCRGB(const char *hexString)
+{
+	// Convert the hex string to an integer value
+	uint32_t hexValue = strtoul(hexString, NULL, 16);
+
+	// Extract the red, green, and blue components from the hex value
+	uint8_t red = (hexValue >> 16) & 0xFF;
+	uint8_t green = (hexValue >> 8) & 0xFF;
+	uint8_t blue = hexValue & 0xFF;
+
+	// Create a CRGB object with the extracted components
+	CRGB color = CRGB(red, green, blue);
+
+	return color;
+}
+
+CRGBA hexValueToCRGBA(uint32_t hexValue)
+{
+	// Extract the red, green, and blue components from the hex value
+	uint8_t red = (hexValue >> 24) & 0xFF;
+	uint8_t green = (hexValue >> 16) & 0xFF;
+	uint8_t blue = (hexValue >> 8) & 0xFF;
+	uint8_t alpha = hexValue & 0xFF;
+
+	// Create a CRGB object with the extracted components
+	CRGBA color = CRGBA(red, green, blue, alpha);
+
+	return color;
+}
+
+/// Streaming pull parser for the JSON pixel payload:
+/// {"meta":{"frames":…,"width":…,"height":…,"backgroundColor":…,"path":…},"rows":[{"frame":0,"row":0,"duration":100,"pixels":["rrggbbaa",…]},…]}
+/// No document is built. Keys are matched as they stream past and pixel hex digits are decoded straight into the
+/// frame arena, so any row width parses in constant memory. Unknown keys and values are skipped.
+class PixelJsonParser
+{
+public:
+	enum Phase : uint8_t
+	{
+		META,
+		ROWS,
+		DONE,
+		ERROR
+	};
+
+	static const uint8_t maxDepth = 16;
+
+private:
+	// what the tokenizer expects next
+	enum Lexer : uint8_t
+	{
+		EXPECT_VALUE,
+		EXPECT_KEY,
+		EXPECT_COLON,
+		AFTER_VALUE,
+		IN_KEY,
+		IN_STRING,
+		IN_NUMBER,
+		IN_LITERAL
+	};
+
+	// what the enclosing container is, as far as the image is concerned
+	enum Context : uint8_t
+	{
+		IN_OTHER,
+		IN_ROOT,
+		IN_META,
+		IN_ROWS,
+		IN_ROW,
+		IN_PIXELS
+	};
+
+	enum Key : uint8_t
+	{
+		KEY_OTHER,
+		KEY_META,
+		KEY_ROWS,
+		KEY_FRAMES,
+		KEY_WIDTH,
+		KEY_HEIGHT,
+		KEY_BACKGROUND,
+		KEY_PATH,
+		KEY_FRAME,
+		KEY_ROW,
+		KEY_DURATION,
+		KEY_PIXELS
+	};
+
+	ImageSlot *slot = nullptr;
+	bool usePalette = false;
+	Phase phase = META;
+	Lexer lexer = EXPECT_VALUE;
+
+	Context stack[maxDepth];
+	uint32_t arrayDepths = 0;
+	uint8_t depth = 0;
+	Key key = KEY_OTHER;
+	bool escaped = false;
+
+	// keys and short string values (path, background) are collected here, truncated if need be
+	char text[64];
+	uint8_t textLength = 0;
+
+	// numbers saturate here rather than overflow, anything that big is out of range wherever it's used
+	static const int32_t maxNumber = 1000000000;
+	int32_t number = 0;
+	bool negative = false;
+	bool fraction = false;
+
+	uint32_t hexValue = 0;
+	bool hexValid = false;
+
+	// meta, applied to the slot once the meta object closes
+	uint16_t metaFrames = 0;
+	uint16_t metaWidth = 0;
+	uint16_t metaHeight = 0;
+
+	// the row being parsed. pixels normally arrive after frame and row, if not they go to scratch first
+	int32_t rowFrame = -1;
+	int32_t rowIndex = -1;
+	int32_t rowDuration = 0;
+	bool rowInScratch = false;
+	uint16_t pixelIndex = 0;
+	CRGBA *scratch = nullptr;
+	uint16_t scratchWidth = 0;
+
+public:
+	String imageName;
+
+	~PixelJsonParser() { free(scratch); }
+
+	/**
+	 * size the scratch row used when a row's pixels arrive before its frame and row numbers
+	 */
+	bool allocate(uint16_t maxWidth)
+	{
+		free(scratch);
+		scratch = (CRGBA *)malloc((size_t)maxWidth * sizeof(CRGBA));
+		scratchWidth = scratch ? maxWidth : 0;
+		return scratch != nullptr;
+	}
+
+	void begin(ImageSlot *target, bool palette)
+	{
+		slot = target;
+		usePalette = palette;
+		phase = META;
+		lexer = EXPECT_VALUE;
+		depth = 0;
+		arrayDepths = 0;
+		key = KEY_OTHER;
+		metaFrames = metaWidth = metaHeight = 0;
+		imageName = "";
+	}
+
+	inline Phase getPhase() const { return phase; }
+
+	/**
+	 * consume one character of the response body
+	 */
+	void feed(char c)
+	{
+		switch (lexer)
+		{
+		case IN_KEY:
+		case IN_STRING:
+			feedString(c);
+			return;
+		case IN_NUMBER:
+			if (c >= '0' && c <= '9')
+			{
+				if (!fraction)
+					number = number < maxNumber / 10 ? number * 10 + (c - '0') : maxNumber;
+				return;
+			}
+			if (c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-')
+			{
+				// only integers matter here, ignore the rest
+				fraction = true;
+				return;
+			}
+			endNumber();
+			// an out of range number stops here, the '}' after it would otherwise close the meta as if it were fine
+			if (phase == ERROR)
+				return;
+			// this character ends the number, handle it below
+			break;
+		case IN_LITERAL:
+			// true, false, null: nothing we need
+			if (c >= 'a' && c <= 'z')
+				return;
+			lexer = AFTER_VALUE;
+			break;
+		default:
+			break;
+		}
+
+		if (c == ' ' || c == '\n' || c == '\r' || c == '\t')
+			return;
+
+		switch (lexer)
+		{
+		case EXPECT_VALUE:
+			if (c == ']' && isArray())
+				endContainer(c);
+			else
+				beginValue(c);
+			break;
+		case EXPECT_KEY:
+			if (c == '"')
+			{
+				lexer = IN_KEY;
+				textLength = 0;
+				escaped = false;
+			}
+			else if (c == '}' && !isArray())
+				endContainer(c);
+			else
+				error();
+			break;
+		case EXPECT_COLON:
+			if (c == ':')
+				lexer = EXPECT_VALUE;
+			else
+				error();
+			break;
+		case AFTER_VALUE:
+			if (c == ',')
+				lexer = isArray() ? EXPECT_VALUE : EXPECT_KEY;
+			else if (c == '}' || c == ']')
+				endContainer(c);
+			else
+				error();
+			break;
+		default:
+			break;
+		}
+	}
+
+private:
+	void error()
+	{
+		if (phase != ERROR)
+			Serial.println("image parse failed, malformed JSON");
+		phase = ERROR;
+	}
+
+	inline bool isArray() const { return depth > 0 && (arrayDepths & (1UL << (depth - 1))); }
+
+	inline Context context() const { return depth > 0 ? stack[depth - 1] : IN_OTHER; }
+
+	static Key lookupKey(const char *name)
+	{
+		static const char *const names[] = {"meta", "rows", "frames", "width", "height", "backgroundColor", "path", "frame", "row", "duration", "pixels"};
+		for (uint8_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+		{
+			if (strcmp(name, names[i]) == 0)
+				return (Key)(i + 1);
+		}
+		return KEY_OTHER;
+	}
+
+	/**
+	 * the meaning of a new container depends on where it sits: array elements on their parent, object members on their key
+	 */
+	Context childContext(bool array) const
+	{
+		const Context parent = context();
+		if (depth == 0)
+			return array ? IN_OTHER : IN_ROOT;
+		if (isArray())
+			return (parent == IN_ROWS && !array) ? IN_ROW : IN_OTHER;
+		if (parent == IN_ROOT && key == KEY_META && !array)
+			return IN_META;
+		if (parent == IN_ROOT && key == KEY_ROWS && array)
+			return IN_ROWS;
+		if (parent == IN_ROW && key == KEY_PIXELS && array)
+			return IN_PIXELS;
+		return IN_OTHER;
+	}
+
+	void beginValue(char c)
+	{
+		if (c == '{' || c == '[')
+		{
+			const bool array = (c == '[');
+			if (depth == maxDepth)
+			{
+				error();
+				return;
+			}
+			const Context child = childContext(array);
+			stack[depth] = child;
+			if (array)
+				arrayDepths |= (1UL << depth);
+			else
+				arrayDepths &= ~(1UL << depth);
+			depth++;
+			lexer = array ? EXPECT_VALUE : EXPECT_KEY;
+
+			if (child == IN_ROW)
+				beginRow();
+			else if (child == IN_PIXELS)
+				beginPixels();
+			return;
+		}
+
+		if (c == '"')
+		{
+			lexer = IN_STRING;
+			textLength = 0;
+			escaped = false;
+			hexValue = 0;
+			hexValid = true;
+			return;
+		}
+
+		if (c == '-' || (c >= '0' && c <= '9'))
+		{
+			lexer = IN_NUMBER;
+			negative = (c == '-');
+			number = negative ? 0 : c - '0';
+			fraction = false;
+			return;
+		}
+
+		if (c >= 'a' && c <= 'z')
+		{
+			lexer = IN_LITERAL;
+			return;
+		}
+
+		error();
+	}
+
+	void endContainer(char c)
+	{
+		if ((c == ']') != isArray())
+		{
+			error();
+			return;
+		}
+
+		const Context closed = context();
+		depth--;
+		lexer = AFTER_VALUE;
+
+		if (closed == IN_META)
+			endMeta();
+		else if (closed == IN_ROW)
+			endRow();
+		else if (closed == IN_ROOT)
+			phase = DONE;
+	}
+
+	void feedString(char c)
+	{
+		if (escaped)
+		{
+			escaped = false;
+			hexValid = false;
+		}
+		else if (c == '\\')
+		{
+			escaped = true;
+			hexValid = false;
+			return;
+		}
+		else if (c == '"')
+		{
+			endString();
+			return;
+		}
+
+		if (lexer == IN_STRING && context() == IN_PIXELS)
+		{
+			// decode as we go, stopping at the first non-hex character like strtoul()
+			if (!hexValid)
+				return;
+			uint8_t nibble;
+			if (c >= '0' && c <= '9')
+				nibble = c - '0';
+			else if (c >= 'a' && c <= 'f')
+				nibble = c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F')
+				nibble = c - 'A' + 10;
+			else
+			{
+				hexValid = false;
+				return;
+			}
+			hexValue = (hexValue << 4) | nibble;
+			return;
+		}
+
+		if (textLength < sizeof(text) - 1)
+			text[textLength++] = c;
+	}
+
+	void endString()
+	{
+		text[textLength] = '\0';
+
+		if (lexer == IN_KEY)
+		{
+			key = lookupKey(text);
+			lexer = EXPECT_COLON;
+			return;
+		}
+
+		lexer = AFTER_VALUE;
+		const Context parent = context();
+		if (parent == IN_PIXELS)
+		{
+			if (rowInScratch)
+			{
+				if (pixelIndex < scratchWidth)
+					scratch[pixelIndex] = hexValueToCRGBA(hexValue);
+			}
+			else if (pixelIndex < slot->sourceWidth && rowIsVisible())
+			{
+				slot->setPixel(rowFrame, pixelIndex, rowIndex, hexValueToCRGBA(hexValue));
+			}
+			pixelIndex++;
+		}
+		else if (parent == IN_META && key == KEY_PATH)
+		{
+			imageName = String(text);
+		}
+		else if (parent == IN_META && key == KEY_BACKGROUND)
+		{
+			slot->backgroundColour = hexToCRGB(text);
+		}
+	}
+
+	void endNumber()
+	{
+		lexer = AFTER_VALUE;
+		const int32_t value = negative ? -number : number;
+		const Context parent = context();
+		if (isArray())
+			return;
+
+		// sizes, frames and rows index 16 bit tables, one past them would wrap round onto another frame or row
+		const bool indexKey = parent == IN_META ? (key == KEY_FRAMES || key == KEY_WIDTH || key == KEY_HEIGHT) : (parent == IN_ROW && (key == KEY_FRAME || key == KEY_ROW));
+		if (indexKey && (value < 0 || value > UINT16_MAX))
+		{
+			error();
+			return;
+		}
+		if (parent == IN_META)
+		{
+			if (key == KEY_FRAMES)
+				metaFrames = value;
+			else if (key == KEY_WIDTH)
+				metaWidth = value;
+			else if (key == KEY_HEIGHT)
+				metaHeight = value;
+		}
+		else if (parent == IN_ROW)
+		{
+			if (key == KEY_FRAME)
+				rowFrame = value;
+			else if (key == KEY_ROW)
+				rowIndex = value;
+			else if (key == KEY_DURATION)
+				rowDuration = constrain(value, 0, (int32_t)UINT16_MAX);
+		}
+	}
+
+	void endMeta()
+	{
+		// the arena was sized up front, so this only fits the image to it
+		slot->beginImage(metaFrames, metaWidth, metaHeight, usePalette, true, true);
+		phase = ROWS;
+	}
+
+	inline bool rowIsVisible() const
+	{
+		return rowFrame >= 0 && rowIndex >= 0 && slot->keepsFrame(rowFrame) && rowIndex < slot->sourceHeight;
+	}
+
+	void beginRow()
+	{
+		rowFrame = rowIndex = -1;
+		rowDuration = 0;
+		rowInScratch = false;
+	}
+
+	void beginPixels()
+	{
+		pixelIndex = 0;
+		// if we don't know where this row goes yet, hold it in scratch.
+		// otherwise rows for frames we dropped, or outside the matrix, are skipped as they arrive
+		rowInScratch = (rowFrame < 0 || rowIndex < 0);
+	}
+
+	void endRow()
+	{
+		// every frame's time counts, a frame skipped to fit holds the one kept before it that much longer
+		if (rowFrame >= 0)
+			slot->setDuration(rowFrame, rowDuration);
+		if (!rowIsVisible())
+			return;
+		if (rowInScratch)
+		{
+			const uint16_t count = min(min(pixelIndex, slot->sourceWidth), scratchWidth);
+			for (uint16_t x = 0; x < count; x++)
+			{
+				slot->setPixel(rowFrame, x, rowIndex, scratch[x]);
+			}
+		}
+	}
+};
+
+/// Layout of the binary pixel payload, requested with format=binary and sent as application/octet-stream.
+/// All multi-byte values are little-endian. The header is followed by the image path, then for each frame
+/// a uint16 duration in ms and the pixel data, row by row, in the given pixel format.
+struct BinaryImageHeader
+{
+	static const uint8_t size = 16;
+	static const uint8_t version = 1;
+
+	enum PixelFormat : uint8_t
+	{
+		// r, g, b, a for every pixel
+		RGBA = 0,
+		// r, g, b for every pixel, then an alpha byte for every pixel
+		RGB_ALPHA_PLANE = 1
+	};
+
+	// "PXAB"
+	uint8_t magic[4];
+	uint8_t formatVersion;
+	uint8_t pixelFormat;
+	uint16_t width;
+	uint16_t height;
+	uint16_t frames;
+	uint8_t background[3];
+	uint8_t pathLength;
+
+	/**
+	 * unpack the header from the first BinaryImageHeader::size bytes of the response
+	 */
+	bool read(const uint8_t *bytes)
+	{
+		memcpy(magic, bytes, 4);
+		formatVersion = bytes[4];
+		pixelFormat = bytes[5];
+		width = bytes[6] | (bytes[7] << 8);
+		height = bytes[8] | (bytes[9] << 8);
+		frames = bytes[10] | (bytes[11] << 8);
+		memcpy(background, bytes + 12, 3);
+		pathLength = bytes[15];
+		return memcmp(magic, "PXAB", 4) == 0 && formatVersion == version && pixelFormat <= RGB_ALPHA_PLANE;
+	}
+};
+
+/// Streaming decoder for GIF images, requested with format=gif and sent as image/gif. Bytes go in one at a time
+/// as they arrive and each frame is composited straight into the slot as its LZW codes decode: transparent
+/// pixels leave what was there, and each frame's disposal method is applied as the next one starts.
+/// The LZW dictionary (~16KB) is only allocated while a GIF is loading.
+class GifDecoder
+{
+public:
+	enum Phase : uint8_t
+	{
+		DECODING,
+		DONE,
+		ERROR
+	};
+
+	static const uint16_t maxCodes = 4096;
+	// one block for the three tables, the stack holds a whole chain plus the byte a KwKwK code repeats
+	static const size_t tableBytes = maxCodes * sizeof(uint16_t) + maxCodes + maxCodes + 1;
+	// browsers play frames with no delay, or next to none, at 10 fps
+	static const uint16_t defaultDelay = 100;
+
+	/**
+	 * the most heap decoding takes at this matrix size: the tables, and a saved frame for frames disposed to the previous one
+	 */
+	static size_t workingBytes(uint16_t width, uint16_t height)
+	{
+		return tableBytes + (size_t)width * height * sizeof(CRGBA);
+	}
+
+private:
+	enum Stage : uint8_t
+	{
+		// "GIF87a" or "GIF89a" and the logical screen descriptor
+		SCREEN,
+		GLOBAL_COLOURS,
+		// an extension, an image or the end
+		BLOCK,
+		EXTENSION_LABEL,
+		IMAGE_DESCRIPTOR,
+		LOCAL_COLOURS,
+		CODE_SIZE,
+		// extensions and image data are both a run of sub-blocks, ended by an empty one
+		SUB_BLOCK_SIZE,
+		SUB_BLOCK
+	};
+
+	enum Disposal : uint8_t
+	{
+		DISPOSE_NONE = 0,
+		DISPOSE_KEEP = 1,
+		DISPOSE_BACKGROUND = 2,
+		DISPOSE_PREVIOUS = 3
+	};
+
+	static const uint8_t screenSize = 13;
+	static const uint8_t descriptorSize = 9;
+	static const uint8_t controlLabel = 0xF9;
+
+	ImageSlot *slot = nullptr;
+	bool usePalette = false;
+	Phase phase = DECODING;
+	Stage stage = SCREEN;
+	// descriptors and the graphic control block are collected here
+	uint8_t bytes[screenSize];
+	uint16_t position = 0;
+
+	uint8_t globalColours[256 * 3];
+	uint16_t globalColourCount = 0;
+	uint8_t localColours[256 * 3];
+	uint16_t localColourCount = 0;
+	bool useLocalColours = false;
+
+	// sub-blocks: what they belong to, and how much of the current one is left
+	bool inImageData = false;
+	uint8_t extensionLabel = 0;
+	uint8_t blockRemaining = 0;
+	uint8_t blockPosition = 0;
+
+	// graphic control for the next image, back to the defaults after it
+	uint8_t disposal = DISPOSE_NONE;
+	bool hasTransparency = false;
+	int16_t transparentIndex = -1;
+	uint16_t delay = defaultDelay;
+
+	// the frame being decoded, and where its pixels have got to
+	uint16_t frame = 0;
+	uint16_t frameLeft = 0;
+	uint16_t frameTop = 0;
+	uint16_t frameWidth = 0;
+	uint16_t frameHeight = 0;
+	bool interlaced = false;
+	uint8_t pass = 0;
+	uint16_t column = 0;
+	uint16_t row = 0;
+	uint16_t rowsDone = 0;
+
+	// the last frame's area and disposal, applied once it's stored and the next frame starts
+	uint8_t lastDisposal = DISPOSE_NONE;
+	uint16_t lastLeft = 0;
+	uint16_t lastTop = 0;
+	uint16_t lastWidth = 0;
+	uint16_t lastHeight = 0;
+	// what DISPOSE_PREVIOUS puts back, clipped to the slot
+	CRGBA *saved = nullptr;
+
+	// LZW dictionary: each code is a shorter code plus one more byte. codes come out backwards through the stack
+	uint16_t *prefix = nullptr;
+	uint8_t *suffix = nullptr;
+	uint8_t *stack = nullptr;
+	uint8_t minCodeSize = 0;
+	uint8_t codeSize = 0;
+	uint16_t clearCode = 0;
+	uint16_t nextCode = 0;
+	int16_t oldCode = -1;
+	uint8_t firstByte = 0;
+	uint32_t bitBuffer = 0;
+	uint8_t bitCount = 0;
+	bool codesEnded = false;
+
+public:
+	~GifDecoder() { release(); }
+
+	/**
+	 * start decoding into target. false if there isn't the memory for the dictionary
+	 */
+	bool begin(ImageSlot *target, bool palette)
+	{
+		if (prefix == nullptr)
+		{
+			prefix = (uint16_t *)malloc(tableBytes);
+			if (prefix == nullptr)
+				return false;
+			suffix = (uint8_t *)(prefix + maxCodes);
+			stack = suffix + maxCodes;
+		}
+		free(saved);
+		saved = nullptr;
+		slot = target;
+		usePalette = palette;
+		phase = DECODING;
+		stage = SCREEN;
+		position = 0;
+		globalColourCount = 0;
+		frame = 0;
+		lastDisposal = DISPOSE_NONE;
+		resetControl();
+		return true;
+	}
+
+	void release()
+	{
+		free(prefix);
+		free(saved);
+		prefix = nullptr;
+		suffix = stack = nullptr;
+		saved = nullptr;
+	}
+
+	inline Phase getPhase() const { return phase; }
+
+	/**
+	 * consume one byte of the response body
+	 */
+	void feed(uint8_t b)
+	{
+		switch (stage)
+		{
+		case SCREEN:
+			bytes[position++] = b;
+			if (position < screenSize)
+				return;
+			if (memcmp(bytes, "GIF8", 4) != 0)
+			{
+				phase = ERROR;
+				return;
+			}
+			globalColourCount = (bytes[10] & 0x80) ? 2 << (bytes[10] & 0x07) : 0;
+			position = 0;
+			if (globalColourCount > 0)
+				stage = GLOBAL_COLOURS;
+			else
+				startImage();
+			return;
+
+		case GLOBAL_COLOURS:
+			globalColours[position++] = b;
+			if (position == globalColourCount * 3)
+				startImage();
+			return;
+
+		case BLOCK:
+			if (b == 0x21)
+			{
+				stage = EXTENSION_LABEL;
+			}
+			else if (b == 0x2C)
+			{
+				stage = IMAGE_DESCRIPTOR;
+				position = 0;
+			}
+			else if (b == 0x3B)
+			{
+				phase = DONE;
+			}
+			else if (b != 0)
+			{
+				// stray zeros turn up after image data in the wild, anything else is broken
+				phase = ERROR;
+			}
+			return;
+
+		case EXTENSION_LABEL:
+			extensionLabel = b;
+			inImageData = false;
+			stage = SUB_BLOCK_SIZE;
+			return;
+
+		case IMAGE_DESCRIPTOR:
+			bytes[position++] = b;
+			if (position < descriptorSize)
+				return;
+			frameLeft = bytes[0] | (bytes[1] << 8);
+			frameTop = bytes[2] | (bytes[3] << 8);
+			frameWidth = bytes[4] | (bytes[5] << 8);
+			frameHeight = bytes[6] | (bytes[7] << 8);
+			interlaced = bytes[8] & 0x40;
+			useLocalColours = bytes[8] & 0x80;
+			localColourCount = useLocalColours ? 2 << (bytes[8] & 0x07) : 0;
+			position = 0;
+			stage = useLocalColours ? LOCAL_COLOURS : CODE_SIZE;
+			return;
+
+		case LOCAL_COLOURS:
+			localColours[position++] = b;
+			if (position == localColourCount * 3)
+				stage = CODE_SIZE;
+			return;
+
+		case CODE_SIZE:
+			// GIF codes pixels of at most 8 bits, anything bigger is a malformed image
+			if (b < 2 || b > 8)
+			{
+				phase = ERROR;
+				return;
+			}
+			minCodeSize = b;
+			startFrame();
+			inImageData = true;
+			stage = SUB_BLOCK_SIZE;
+			return;
+
+		case SUB_BLOCK_SIZE:
+			blockRemaining = b;
+			blockPosition = 0;
+			if (b > 0)
+			{
+				stage = SUB_BLOCK;
+				return;
+			}
+			if (inImageData)
+				endFrame();
+			stage = BLOCK;
+			return;
+
+		case SUB_BLOCK:
+			if (inImageData)
+				feedCodes(b);
+			else if (extensionLabel == controlLabel)
+				feedControl(b);
+			blockPosition++;
+			if (--blockRemaining == 0)
+				stage = SUB_BLOCK_SIZE;
+			return;
+		}
+	}
+
+private:
+	/**
+	 * the screen size and colours are known, set the slot up for frames of unknown number
+	 */
+	void startImage()
+	{
+		const uint8_t background = bytes[11];
+		if (background < globalColourCount)
+			slot->backgroundColour = CRGB(globalColours[background * 3], globalColours[background * 3 + 1], globalColours[background * 3 + 2]);
+		else
+			slot->backgroundColour = CRGB(0, 0, 0);
+		// as many frames as fit, finishImage() settles the count
+		slot->beginImage(UINT16_MAX, bytes[6] | (bytes[7] << 8), bytes[8] | (bytes[9] << 8), usePalette);
+		stage = BLOCK;
+	}
+
+	void resetControl()
+	{
+		disposal = DISPOSE_NONE;
+		hasTransparency = false;
+		transparentIndex = -1;
+		delay = defaultDelay;
+	}
+
+	void feedControl(uint8_t b)
+	{
+		// packed fields, delay in 1/100s, transparent colour index
+		switch (blockPosition)
+		{
+		case 0:
+			disposal = (b >> 2) & 0x07;
+			hasTransparency = b & 0x01;
+			break;
+		case 1:
+			delay = b;
+			break;
+		case 2:
+			delay |= b << 8;
+			delay = delay < 2 ? defaultDelay : min(delay * 10UL, 65535UL);
+			break;
+		case 3:
+			transparentIndex = hasTransparency ? b : -1;
+			break;
+		}
+	}
+
+	/**
+	 * apply the last frame's disposal to the canvas the new frame draws over
+	 */
+	void disposeLastFrame()
+	{
+		if (lastDisposal != DISPOSE_BACKGROUND && lastDisposal != DISPOSE_PREVIOUS)
+			return;
+		// in 32 bits, a frame placed near the 16 bit limit would otherwise wrap round onto the top left
+		const uint16_t right = min((uint32_t)lastLeft + lastWidth, (uint32_t)slot->width);
+		const uint16_t bottom = min((uint32_t)lastTop + lastHeight, (uint32_t)slot->height);
+		const CRGBA clear(0, 0, 0, 0);
+		size_t i = 0;
+		for (uint16_t y = lastTop; y < bottom; y++)
+		{
+			for (uint16_t x = lastLeft; x < right; x++)
+			{
+				// restoring to background clears to transparent, the way browsers show it
+				slot->setPixel(frame, x, y, lastDisposal == DISPOSE_PREVIOUS && saved != nullptr ? saved[i++] : clear);
+			}
+		}
+		free(saved);
+		saved = nullptr;
+	}
+
+	void startFrame()
+	{
+		codeSize = minCodeSize + 1;
+		clearCode = 1 << minCodeSize;
+		nextCode = clearCode + 2;
+		oldCode = -1;
+		bitBuffer = 0;
+		bitCount = 0;
+		codesEnded = false;
+		for (uint16_t code = 0; code < clearCode; code++)
+			suffix[code] = code;
+		column = row = rowsDone = 0;
+		pass = 0;
+
+		// stores the frame before, so the canvas is ready to dispose of it. frames past what fits still decode, to nowhere
+		if (!slot->startFrame(frame))
+		{
+			// a dropped frame is never disposed of, and what the frame before saved is no use past it
+			free(saved);
+			saved = nullptr;
+			return;
+		}
+		if (frame == 0 && (hasTransparency || frameLeft > 0 || frameTop > 0 || frameWidth < slot->width || frameHeight < slot->height))
+		{
+			// the canvas starts out transparent. a palette frame's zeros are whatever colour came first, so set it properly
+			// unless the first frame is going to cover all of it
+			for (uint16_t y = 0; y < slot->height; y++)
+			{
+				for (uint16_t x = 0; x < slot->width; x++)
+					slot->setPixel(frame, x, y, CRGBA(0, 0, 0, 0));
+			}
+		}
+		disposeLastFrame();
+		slot->setDuration(frame, delay);
+
+		if (disposal == DISPOSE_PREVIOUS && frameLeft < slot->width && frameTop < slot->height)
+		{
+			const uint16_t right = min((uint32_t)frameLeft + frameWidth, (uint32_t)slot->width);
+			const uint16_t bottom = min((uint32_t)frameTop + frameHeight, (uint32_t)slot->height);
+			saved = (CRGBA *)malloc((size_t)(right - frameLeft) * (bottom - frameTop) * sizeof(CRGBA));
+			size_t i = 0;
+			for (uint16_t y = frameTop; saved != nullptr && y < bottom; y++)
+			{
+				for (uint16_t x = frameLeft; x < right; x++)
+					saved[i++] = slot->loadedPixel(x, y);
+			}
+		}
+	}
+
+	void endFrame()
+	{
+		lastDisposal = disposal;
+		lastLeft = frameLeft;
+		lastTop = frameTop;
+		lastWidth = frameWidth;
+		lastHeight = frameHeight;
+		resetControl();
+		frame++;
+	}
+
+	void feedCodes(uint8_t b)
+	{
+		bitBuffer |= (uint32_t)b << bitCount;
+		bitCount += 8;
+		while (bitCount >= codeSize && !codesEnded && phase == DECODING)
+		{
+			const uint16_t code = bitBuffer & ((1 << codeSize) - 1);
+			bitBuffer >>= codeSize;
+			bitCount -= codeSize;
+			decodeCode(code);
+		}
+	}
+
+	void decodeCode(uint16_t code)
+	{
+		if (code == clearCode)
+		{
+			codeSize = minCodeSize + 1;
+			nextCode = clearCode + 2;
+			oldCode = -1;
+			return;
+		}
+		if (code == clearCode + 1)
+		{
+			// anything left in the sub-blocks is padding
+			codesEnded = true;
+			return;
+		}
+		if (oldCode < 0)
+		{
+			if (code >= clearCode)
+			{
+				phase = ERROR;
+				return;
+			}
+			firstByte = code;
+			oldCode = code;
+			emit(code);
+			return;
+		}
+		if (code > nextCode)
+		{
+			phase = ERROR;
+			return;
+		}
+
+		const uint16_t incoming = code;
+		uint16_t depth = 0;
+		if (code == nextCode)
+		{
+			// not in the dictionary yet: the last string plus its own first byte
+			stack[depth++] = firstByte;
+			code = oldCode;
+		}
+		while (code >= clearCode)
+		{
+			stack[depth++] = suffix[code];
+			code = prefix[code];
+		}
+		firstByte = code;
+		stack[depth++] = code;
+		while (depth > 0)
+			emit(stack[--depth]);
+
+		if (nextCode < maxCodes)
+		{
+			prefix[nextCode] = oldCode;
+			suffix[nextCode] = firstByte;
+			nextCode++;
+			if (nextCode == (1 << codeSize) && codeSize < 12)
+				codeSize++;
+		}
+		oldCode = incoming;
+	}
+
+	/**
+	 * place the next pixel of the frame, in row order or the four interlaced passes
+	 */
+	void emit(uint8_t index)
+	{
+		if (rowsDone >= frameHeight)
+			return;
+		const uint32_t x = (uint32_t)frameLeft + column;
+		const uint32_t y = (uint32_t)frameTop + row;
+		if (index != transparentIndex && x < slot->width && y < slot->height && slot->keepsFrame(frame))
+		{
+			const uint8_t *colours = useLocalColours ? localColours : globalColours;
+			const uint16_t count = useLocalColours ? localColourCount : globalColourCount;
+			if (index < count)
+				slot->setPixel(frame, x, y, CRGBA(colours[index * 3], colours[index * 3 + 1], colours[index * 3 + 2], 255));
+		}
+		if (++column < frameWidth)
+			return;
+
+		column = 0;
+		rowsDone++;
+		if (!interlaced)
+		{
+			row++;
+			return;
+		}
+		static const uint8_t passStart[4] = {0, 4, 2, 1};
+		static const uint8_t passStep[4] = {8, 8, 4, 2};
+		row += passStep[pass];
+		while (row >= frameHeight && pass < 3)
+		{
+			pass++;
+			row = passStart[pass];
+		}
+	}
+};
+
+/// Streaming decoder for Content-Encoding: gzip responses. Compressed bytes go in as they arrive, in pieces of
+/// any size, and each decoded byte goes straight on to a sink, so nothing bigger than the 32KB history window
+/// is ever held. Huffman codes are decoded a bit at a time from the count of codes of each length rather than
+/// through lookup tables, which keeps the tables to ~1KB.
+class GzipInflater
+{
+public:
+	enum Result : uint8_t
+	{
+		MORE,
+		FINISHED,
+		ERROR
+	};
+
+	static const size_t windowSize = 32768;
+
+private:
+	struct HuffmanTable
+	{
+		// number of codes of each length, then the symbols in code order
+		uint16_t counts[16];
+		uint16_t symbols[288];
+	};
+
+	enum Stage : uint8_t
+	{
+		GZIP_HEADER,
+		BLOCK_HEADER,
+		STORED_LENGTH,
+		STORED_CHECK,
+		STORED_DATA,
+		TABLE_SIZES,
+		CODE_LENGTH_LENGTHS,
+		CODE_LENGTHS,
+		SYMBOL,
+		DISTANCE,
+		DISTANCE_EXTRA,
+		COPY,
+		TRAILER,
+		END,
+		FAILED
+	};
+
+	static const int needMoreBits = -1;
+	static const int invalidCode = -2;
+	static const uint8_t codeLengthOrder[19];
+	static const uint16_t lengthBase[29];
+	static const uint8_t lengthExtra[29];
+	static const uint16_t distanceBase[30];
+	static const uint8_t distanceExtra[30];
+
+	Stage stage = GZIP_HEADER;
+	uint8_t *window = nullptr;
+	uint16_t windowPosition = 0;
+	uint32_t outputSize = 0;
+
+	// bits not yet used, least significant first
+	uint32_t bits = 0;
+	uint8_t bitCount = 0;
+	bool finalBlock = false;
+
+	// gzip header: the fixed 10 bytes, then whichever optional fields its flags say follow
+	uint8_t headerField = 0;
+	uint8_t headerFlags = 0;
+	uint16_t headerPosition = 0;
+	uint16_t extraLength = 0;
+
+	HuffmanTable literals;
+	HuffmanTable distances;
+	// code lengths of a dynamic block's literal/length codes, then its distance codes
+	uint8_t lengths[288 + 32];
+	uint16_t literalCount = 0;
+	uint8_t distanceCount = 0;
+	uint8_t codeLengthCount = 0;
+	uint16_t lengthsRead = 0;
+
+	uint16_t storedRemaining = 0;
+	uint16_t matchLength = 0;
+	uint16_t matchDistance = 0;
+	uint8_t distanceSymbol = 0;
+	uint8_t trailer[8];
+	uint8_t trailerRead = 0;
+
+public:
+	~GzipInflater() { release(); }
+
+	/**
+	 * get ready for a new stream, false if the window can't be allocated
+	 */
+	bool begin()
+	{
+		if (window == nullptr)
+			window = (uint8_t *)malloc(windowSize);
+		stage = GZIP_HEADER;
+		windowPosition = 0;
+		outputSize = 0;
+		bits = 0;
+		bitCount = 0;
+		headerField = 0;
+		headerPosition = 0;
+		return window != nullptr;
+	}
+
+	void release()
+	{
+		free(window);
+		window = nullptr;
+	}
+
+	inline bool isAllocated() const { return window != nullptr; }
+
+	/**
+	 * decode as much as the input allows, passing every byte out to sink(uint8_t)
+	 */
+	template <typename Sink>
+	Result feed(const uint8_t *input, size_t length, Sink &&sink)
+	{
+		size_t position = 0;
+		while (stage == GZIP_HEADER && position < length)
+		{
+			if (!feedHeader(input[position++]))
+				stage = FAILED;
+		}
+		while (true)
+		{
+			// no step needs more than 25 bits, so a step only runs short once the input has
+			while (bitCount <= 24 && position < length)
+			{
+				bits |= (uint32_t)input[position++] << bitCount;
+				bitCount += 8;
+			}
+			if (!step(sink))
+				break;
+		}
+		return stage == END ? FINISHED : stage == FAILED ? ERROR : MORE;
+	}
+
+private:
+	bool feedHeader(uint8_t b)
+	{
+		switch (headerField)
+		{
+		case 0:
+			// magic, deflate, flags, then mtime, extra flags and OS which don't matter here
+			if ((headerPosition == 0 && b != 0x1f) || (headerPosition == 1 && b != 0x8b) || (headerPosition == 2 && b != 8))
+				return false;
+			if (headerPosition == 3)
+				headerFlags = b;
+			if (++headerPosition < 10)
+				return true;
+			extraLength = 0;
+			break;
+		case 1:
+			extraLength |= b << (8 * headerPosition);
+			if (++headerPosition < 2)
+				return true;
+			headerField = 2;
+			headerPosition = 0;
+			if (extraLength > 0)
+				return true;
+			break;
+		case 2:
+			if (++headerPosition < extraLength)
+				return true;
+			break;
+		case 3:
+		case 4:
+			// file name and comment, zero terminated
+			if (b != 0)
+				return true;
+			break;
+		case 5:
+			// header CRC
+			if (++headerPosition < 2)
+				return true;
+			break;
+		}
+		nextHeaderField();
+		return true;
+	}
+
+	void nextHeaderField()
+	{
+		headerPosition = 0;
+		if (headerField < 1 && (headerFlags & 0x04))
+			headerField = 1;
+		else if (headerField < 3 && (headerFlags & 0x08))
+			headerField = 3;
+		else if (headerField < 4 && (headerFlags & 0x10))
+			headerField = 4;
+		else if (headerField < 5 && (headerFlags & 0x02))
+			headerField = 5;
+		else
+			stage = BLOCK_HEADER;
+	}
+
+	inline uint32_t takeBits(uint8_t count)
+	{
+		const uint32_t value = bits & ((1UL << count) - 1);
+		bits >>= count;
+		bitCount -= count;
+		return value;
+	}
+
+	/**
+	 * the next symbol in the bit buffer, without using it up. used is set to the length of its code
+	 */
+	int peekSymbol(const HuffmanTable &table, uint8_t &used) const
+	{
+		int code = 0;
+		int first = 0;
+		int index = 0;
+		for (uint8_t length = 1; length < 16; length++)
+		{
+			if (length > bitCount)
+				return needMoreBits;
+			code |= (bits >> (length - 1)) & 1;
+			const int count = table.counts[length];
+			if (code - first < count)
+			{
+				used = length;
+				return table.symbols[index + code - first];
+			}
+			index += count;
+			first = (first + count) << 1;
+			code <<= 1;
+		}
+		return invalidCode;
+	}
+
+	static void buildTable(HuffmanTable &table, const uint8_t *codeLengths, uint16_t count)
+	{
+		memset(table.counts, 0, sizeof(table.counts));
+		for (uint16_t i = 0; i < count; i++)
+			table.counts[codeLengths[i]]++;
+		uint16_t offsets[16];
+		offsets[1] = 0;
+		for (uint8_t length = 1; length < 15; length++)
+			offsets[length + 1] = offsets[length] + table.counts[length];
+		for (uint16_t i = 0; i < count; i++)
+		{
+			if (codeLengths[i] != 0)
+				table.symbols[offsets[codeLengths[i]]++] = i;
+		}
+	}
+
+	void buildFixedTables()
+	{
+		memset(lengths, 8, 144);
+		memset(lengths + 144, 9, 112);
+		memset(lengths + 256, 7, 24);
+		memset(lengths + 280, 8, 8);
+		buildTable(literals, lengths, 288);
+		memset(lengths, 5, 30);
+		buildTable(distances, lengths, 30);
+	}
+
+	template <typename Sink>
+	inline void output(uint8_t b, Sink &sink)
+	{
+		window[windowPosition++ & (windowSize - 1)] = b;
+		outputSize++;
+		sink(b);
+	}
+
+	Stage endOfBlock()
+	{
+		if (!finalBlock)
+			return BLOCK_HEADER;
+		// the trailer starts on a byte boundary
+		takeBits(bitCount % 8);
+		trailerRead = 0;
+		return TRAILER;
+	}
+
+	inline bool fail()
+	{
+		stage = FAILED;
+		return false;
+	}
+
+	/**
+	 * one step of the decode, false once it needs more input or has finished
+	 */
+	template <typename Sink>
+	bool step(Sink &sink)
+	{
+		uint8_t used = 0;
+		int symbol;
+		switch (stage)
+		{
+		case BLOCK_HEADER:
+			if (bitCount < 3)
+				return false;
+			finalBlock = takeBits(1);
+			switch (takeBits(2))
+			{
+			case 0:
+				takeBits(bitCount % 8);
+				stage = STORED_LENGTH;
+				break;
+			case 1:
+				buildFixedTables();
+				stage = SYMBOL;
+				break;
+			case 2:
+				stage = TABLE_SIZES;
+				break;
+			default:
+				return fail();
+			}
+			return true;
+
+		case STORED_LENGTH:
+			if (bitCount < 16)
+				return false;
+			storedRemaining = takeBits(16);
+			stage = STORED_CHECK;
+			return true;
+
+		case STORED_CHECK:
+			if (bitCount < 16)
+				return false;
+			if ((takeBits(16) ^ 0xFFFF) != storedRemaining)
+				return fail();
+			stage = storedRemaining > 0 ? STORED_DATA : endOfBlock();
+			return true;
+
+		case STORED_DATA:
+			if (bitCount < 8)
+				return false;
+			output(takeBits(8), sink);
+			if (--storedRemaining == 0)
+				stage = endOfBlock();
+			return true;
+
+		case TABLE_SIZES:
+			if (bitCount < 14)
+				return false;
+			literalCount = takeBits(5) + 257;
+			distanceCount = takeBits(5) + 1;
+			codeLengthCount = takeBits(4) + 4;
+			if (literalCount > 286 || distanceCount > 30)
+				return fail();
+			memset(lengths, 0, 19);
+			lengthsRead = 0;
+			stage = CODE_LENGTH_LENGTHS;
+			return true;
+
+		case CODE_LENGTH_LENGTHS:
+			if (bitCount < 3)
+				return false;
+			lengths[codeLengthOrder[lengthsRead]] = takeBits(3);
+			if (++lengthsRead < codeLengthCount)
+				return true;
+			// the code length code is only needed until the real tables are built, so it borrows the distance table
+			buildTable(distances, lengths, 19);
+			lengthsRead = 0;
+			stage = CODE_LENGTHS;
+			return true;
+
+		case CODE_LENGTHS:
+		{
+			symbol = peekSymbol(distances, used);
+			if (symbol < 0)
+				return symbol == needMoreBits ? false : fail();
+			const uint8_t extra = symbol == 16 ? 2 : symbol == 17 ? 3 : symbol == 18 ? 7 : 0;
+			if (bitCount < used + extra)
+				return false;
+			takeBits(used);
+			const uint16_t total = literalCount + distanceCount;
+			if (symbol < 16)
+			{
+				lengths[lengthsRead++] = symbol;
+			}
+			else
+			{
+				// 16 repeats the last length, 17 and 18 are runs of zeros
+				if (symbol == 16 && lengthsRead == 0)
+					return fail();
+				const uint8_t value = symbol == 16 ? lengths[lengthsRead - 1] : 0;
+				const uint16_t repeat = (symbol == 16 ? 3 : symbol == 17 ? 3 : 11) + takeBits(extra);
+				if (lengthsRead + repeat > total)
+					return fail();
+				memset(lengths + lengthsRead, value, repeat);
+				lengthsRead += repeat;
+			}
+			if (lengthsRead < total)
+				return true;
+			buildTable(literals, lengths, literalCount);
+			buildTable(distances, lengths + literalCount, distanceCount);
+			stage = SYMBOL;
+			return true;
+		}
+
+		case SYMBOL:
+			symbol = peekSymbol(literals, used);
+			if (symbol < 0)
+				return symbol == needMoreBits ? false : fail();
+			if (symbol < 256)
+			{
+				takeBits(used);
+				output(symbol, sink);
+				return true;
+			}
+			if (symbol == 256)
+			{
+				takeBits(used);
+				stage = endOfBlock();
+				return true;
+			}
+			symbol -= 257;
+			if (symbol >= 29)
+				return fail();
+			if (bitCount < used + lengthExtra[symbol])
+				return false;
+			takeBits(used);
+			matchLength = lengthBase[symbol] + takeBits(lengthExtra[symbol]);
+			stage = DISTANCE;
+			return true;
+
+		case DISTANCE:
+			symbol = peekSymbol(distances, used);
+			if (symbol < 0)
+				return symbol == needMoreBits ? false : fail();
+			if (symbol >= 30)
+				return fail();
+			takeBits(used);
+			distanceSymbol = symbol;
+			stage = DISTANCE_EXTRA;
+			return true;
+
+		case DISTANCE_EXTRA:
+			// read separately from the code, together they could need more bits than the buffer is sure to hold
+			if (bitCount < distanceExtra[distanceSymbol])
+				return false;
+			matchDistance = distanceBase[distanceSymbol] + takeBits(distanceExtra[distanceSymbol]);
+			if (matchDistance > outputSize)
+				return fail();
+			stage = COPY;
+			return true;
+
+		case COPY:
+			for (; matchLength > 0; matchLength--)
+				output(window[(uint16_t)(windowPosition - matchDistance) & (windowSize - 1)], sink);
+			stage = SYMBOL;
+			return true;
+
+		case TRAILER:
+			if (bitCount < 8)
+				return false;
+			trailer[trailerRead++] = takeBits(8);
+			if (trailerRead < sizeof(trailer))
+				return true;
+			// CRC32 then the decoded length. TCP has already checksummed the bytes, the length catches a truncated stream
+			stage = (trailer[4] | (trailer[5] << 8) | (trailer[6] << 16) | ((uint32_t)trailer[7] << 24)) == outputSize ? END : FAILED;
+			return false;
+
+		default:
+			return false;
+		}
+	}
+};
+
+const uint8_t GzipInflater::codeLengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+const uint16_t GzipInflater::lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t GzipInflater::lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t GzipInflater::distanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+const uint8_t GzipInflater::distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+/// Where a response body ends: after Content-Length bytes, after the last chunk of a chunked body, or when the
+/// server closes the connection. Chunk sizes and trailers are taken out here, so the parsers behind it only see
+/// the body itself, and a body read to its end leaves the connection ready for the next request.
+class HttpBody
+{
+public:
+	enum Framing : uint8_t
+	{
+		UNTIL_CLOSE,
+		LENGTH,
+		CHUNKED
+	};
+
+private:
+	enum Stage : uint8_t
+	{
+		CHUNK_SIZE,
+		CHUNK_EXTENSION,
+		DATA,
+		CHUNK_DATA_END,
+		CHUNK_TRAILER,
+		END
+	};
+
+	Framing framing = UNTIL_CLOSE;
+	Stage stage = DATA;
+	// bytes left in the body or the current chunk
+	size_t remaining = 0;
+	bool sizeDigits = false;
+	uint8_t trailerLineLength = 0;
+
+public:
+	void begin(Framing bodyFraming, size_t length = 0)
+	{
+		framing = bodyFraming;
+		remaining = length;
+		sizeDigits = false;
+		if (framing == CHUNKED)
+			stage = CHUNK_SIZE;
+		else
+			stage = (framing == LENGTH && length == 0) ? END : DATA;
+	}
+
+	inline bool finished() const { return stage == END; }
+
+	/**
+	 * body bytes that can be read before there's framing to take out, 0 if framing comes next
+	 */
+	inline size_t payloadAvailable() const
+	{
+		if (stage != DATA)
+			return 0;
+		return framing == UNTIL_CLOSE ? SIZE_MAX : remaining;
+	}
+
+	void takePayload(size_t count)
+	{
+		if (framing == UNTIL_CLOSE)
+			return;
+		remaining -= count;
+		if (remaining == 0)
+			stage = framing == CHUNKED ? CHUNK_DATA_END : END;
+	}
+
+	/**
+	 * a byte of framing: a chunk size line, the line break after a chunk, or the trailer. false if it's malformed
+	 */
+	bool feedFraming(uint8_t b)
+	{
+		switch (stage)
+		{
+		case CHUNK_SIZE:
+		{
+			const int digit = (b >= '0' && b <= '9') ? b - '0' : ((b | 0x20) >= 'a' && (b | 0x20) <= 'f') ? (b | 0x20) - 'a' + 10 : -1;
+			if (digit >= 0)
+			{
+				remaining = remaining * 16 + digit;
+				sizeDigits = true;
+				return remaining < 0x1000000;
+			}
+			if (!sizeDigits)
+				return false;
+			stage = CHUNK_EXTENSION;
+		}
+			// fall through, anything after the size is an extension to ignore
+		case CHUNK_EXTENSION:
+			if (b == '\n')
+			{
+				stage = remaining > 0 ? DATA : CHUNK_TRAILER;
+				trailerLineLength = 0;
+			}
+			return true;
+		case CHUNK_DATA_END:
+			if (b == '\n')
+			{
+				stage = CHUNK_SIZE;
+				remaining = 0;
+				sizeDigits = false;
+			}
+			return b == '\r' || b == '\n';
+		case CHUNK_TRAILER:
+			// header lines until a blank one
+			if (b == '\n')
+			{
+				if (trailerLineLength == 0)
+					stage = END;
+				trailerLineLength = 0;
+			}
+			else if (b != '\r')
+			{
+				trailerLineLength = 1;
+			}
+			return true;
+		default:
+			// nothing should follow the end of the body
+			return false;
+		}
+	}
+};
+
+/// Resumable fetch and parse of one /api/image/pixels response into an ImageSlot.
+/// Each call to advance() does a bounded slice of work and returns, so loop() can drive it
+/// without freezing the redraw while an image downloads.
+/// The server is asked for the binary payload or the original GIF, if it answers with JSON instead that is parsed as before.
+/// Small JSON documents such as the playlist manifest come the same way, read whole into a buffer for the requester.
+/// The connection is kept open between requests when the server allows it, and chunked or gzipped
+/// bodies are unwrapped on the way through.
+class ImageFetch
+{
+public:
+	enum State : uint8_t
+	{
+		IDLE,
+		CONNECT,
+		HEADERS,
+		META,
+		ROWS,
+		BINARY_HEADER,
+		BINARY_DURATION,
+		BINARY_PIXELS,
+		GIF,
+		// a document rather than an image, see beginDocument()
+		DOCUMENT,
+		// the image is complete, reading what's left of the body so the connection can be reused
+		DRAIN,
+		DONE,
+		// the server's next image is the one we already have, nothing was loaded
+		UNCHANGED,
+		FAILED
+	};
+
+	// give up if the server goes quiet for this long mid-response
+	static const unsigned long stallTimeout = 5000;
+	// past the end of the image, only wait this long and read this much more for the end of the body.
+	// anything longer and the connection is closed instead
+	static const unsigned long drainTimeout = 200;
+	static const size_t drainLimit = 512;
+	// only ask for gzip when the inflate window leaves this much heap free
+	static const uint32_t gzipHeapReserve = 32 * 1024;
+
+private:
+	State state = IDLE;
+	WiFiClient &client;
+	ImageSlot *slot = nullptr;
+
+	String host;
+	String path;
+	uint16_t port = 80;
+	unsigned long lastProgressTime = 0;
+	// where the open connection goes, if there is one
+	String connectedHost;
+	uint16_t connectedPort = 0;
+	bool reusingConnection = false;
+
+	// status line / header parsing
+	char line[128];
+	uint8_t lineLength = 0;
+	bool statusParsed = false;
+	int responseCode = 0;
+	bool binaryResponse = false;
+	bool gifResponse = false;
+	bool keepAlive = false;
+	bool chunked = false;
+	long contentLength = -1;
+	bool gzipped = false;
+
+	HttpBody body;
+	GzipInflater inflater;
+	bool acceptGzip = false;
+	size_t drained = 0;
+
+	// binary payload progress: header bytes, then position within the current frame
+	BinaryImageHeader binaryHeader;
+	uint16_t binaryBytesRead = 0;
+	uint16_t binaryFrame = 0;
+	uint16_t binaryX = 0;
+	uint16_t binaryY = 0;
+	uint16_t binaryDuration = 0;
+	uint8_t binaryChannel = 0;
+	uint8_t binaryPlane = 0;
+	CRGBA binaryPixel;
+
+	PixelJsonParser json;
+	GifDecoder gif;
+	bool usePalette = false;
+	// the size asked of the server, 0 for the slot's own size
+	uint16_t requestWidth = 0;
+	uint16_t requestHeight = 0;
+
+	ImageCache *cache = nullptr;
+	bool cacheHit = false;
+
+	// the image the requester already has, sent as If-None-Match and checked against the response
+	String knownName;
+	String knownTag;
+	// the image the response will be, if the requester knows. looked for in the cache before asking the server
+	String expectedName;
+	// the requester's buffer a document is read into, instead of an image into a slot
+	char *document = nullptr;
+	size_t documentCapacity = 0;
+	size_t documentLength = 0;
+
+	// for the metrics: when the request started, bytes read off the connection and time spent reading and parsing them
+	unsigned long startTime = 0;
+	uint32_t bytesReceived = 0;
+	unsigned long readTime = 0;
+
+public:
+	String imageName;
+	String imageTag;
+
+	ImageFetch(WiFiClient &wifiClient) : client(wifiClient) {}
+
+	bool allocate(uint16_t maxWidth)
+	{
+		return json.allocate(maxWidth);
+	}
+
+	inline State getState() const { return state; }
+	inline bool isBusy() const { return state != IDLE && state != DONE && state != UNCHANGED && state != FAILED; }
+	inline int getResponseCode() const { return responseCode; }
+	inline bool wasCached() const { return cacheHit; }
+	inline unsigned long getElapsed() const { return millis() - startTime; }
+	inline uint32_t getBytesReceived() const { return bytesReceived; }
+	// microseconds, not counting the connect
+	inline unsigned long getReadTime() const { return readTime; }
+
+	/**
+	 * images found in the cache are loaded from there once the response names them, and new ones are saved to it
+	 * by saveToCache()
+	 */
+	inline void setCache(ImageCache *imageCache) { cache = imageCache; }
+
+	inline bool hasPendingSave() const { return cache != nullptr && cache->isSaving(); }
+
+	/**
+	 * write the next piece of the last new image to the cache. left out of advance() for the requester to make in
+	 * loop()s of its own, one piece each. the slot may have been given up since, nothing is saved then
+	 */
+	void saveToCache()
+	{
+		if (cache != nullptr)
+			cache->saveNext();
+	}
+
+	/**
+	 * give up the image being saved, for when its slot is about to go
+	 */
+	void cancelSave()
+	{
+		if (cache != nullptr)
+			cache->cancelSave();
+	}
+
+	bool begin(const String &url, ImageSlot *target, bool palette, uint16_t width = 0, uint16_t height = 0)
+	{
+		if (!start(url))
+			return false;
+		slot = target;
+		slot->frameCount = 0;
+		slot->name = "";
+		slot->tag = "";
+		usePalette = palette;
+		requestWidth = width;
+		requestHeight = height;
+		return true;
+	}
+
+	/**
+	 * fetch a JSON document into `buffer`, instead of an image. once DONE it holds getDocumentLength() bytes and a
+	 * terminating 0, a document that doesn't fit fails
+	 */
+	bool beginDocument(const String &url, char *buffer, size_t capacity)
+	{
+		if (!start(url))
+			return false;
+		document = buffer;
+		documentCapacity = capacity;
+		return true;
+	}
+
+	inline size_t getDocumentLength() const { return documentLength; }
+
+	/**
+	 * the image the requester already has, by name and ETag. if the response turns out to be the same image it ends
+	 * UNCHANGED, before any of it loads. call after begin()
+	 */
+	void skipIfUnchanged(const String &name, const String &tag)
+	{
+		knownName = name;
+		knownTag = tag;
+	}
+
+	/**
+	 * the name the image will have, when the requester knows it up front. a cached copy then loads without a request
+	 * at all. call after begin()
+	 */
+	void expectImage(const String &name)
+	{
+		expectedName = name;
+	}
+
+	/**
+	 * end the request. the connection stays open for the next one if the last response was read to its end
+	 */
+	void reset()
+	{
+		if (isBusy())
+			client.stop();
+		inflater.release();
+		gif.release();
+		state = IDLE;
+	}
+
+	/**
+	 * move the request along for at most budgetMs milliseconds, returning the resulting state
+	 */
+	State advance(unsigned long budgetMs)
+	{
+		const unsigned long sliceStart = millis();
+
+		if (state == CONNECT && expectedName.length() > 0)
+		{
+			imageName = expectedName;
+			if (loadFromCache())
+				state = DONE;
+			else
+				imageName = "";
+		}
+		if (state == CONNECT)
+		{
+			reusingConnection = client.connected() && connectedHost == host && connectedPort == port;
+			if (!reusingConnection)
+			{
+				client.stop();
+				// DNS and the TCP handshake are the one step still made in a single blocking call
+				if (!client.connect(host.c_str(), port))
+				{
+					Serial.print("image fetch failed, could not connect to ");
+					Serial.println(host);
+					return fail();
+				}
+				connectedHost = host;
+				connectedPort = port;
+			}
+			const String hostHeader = (port == 80 || port == 443) ? host : host + ":" + String(port);
+			client.print(String("GET ") + path + " HTTP/1.1\r\nHost: " + hostHeader + "\r\nAccept: image/gif, application/octet-stream, application/json\r\n" + (acceptGzip ? "Accept-Encoding: gzip\r\n" : "") + (knownTag.length() > 0 ? "If-None-Match: " + knownTag + "\r\n" : "") + "Connection: keep-alive\r\n\r\n");
+			state = HEADERS;
+			lastProgressTime = millis();
+		}
+
+		uint8_t buffer[64];
+		const unsigned long readStart = micros();
+		while (isBusy() && millis() - sliceStart < budgetMs)
+		{
+			const int available = client.available();
+			if (available <= 0)
+			{
+				if (!client.connected())
+				{
+					if (state == DRAIN || (state == DOCUMENT && contentLength < 0 && !chunked))
+					{
+						// the server ended the body by closing, the image was already complete. a document without
+						// a length ends the same way
+						finishDocument();
+						state = DONE;
+						break;
+					}
+					if (reusingConnection && state == HEADERS && !statusParsed && lineLength == 0)
+					{
+						// the server dropped the kept-alive connection before answering, try again on a new one
+						client.stop();
+						state = CONNECT;
+						return state;
+					}
+					// the server closed the connection, which is only fine once every row has been read
+					Serial.println("image fetch failed, connection closed mid-response");
+					return fail();
+				}
+				if (state == DRAIN && millis() - lastProgressTime > drainTimeout)
+				{
+					state = DONE;
+					break;
+				}
+				if (millis() - lastProgressTime > stallTimeout)
+				{
+					Serial.println("image fetch failed, server stopped responding");
+					return fail();
+				}
+				break;
+			}
+
+			lastProgressTime = millis();
+
+			// whole runs of visible RGBA pixels are read straight into the frame being loaded
+			uint8_t *direct = nullptr;
+			const size_t directLength = (state == HEADERS || gzipped) ? 0 : min(binaryDirectRun(direct), body.payloadAvailable());
+			if (directLength > 0)
+			{
+				const int count = client.read(direct, min((size_t)available, directLength));
+				if (count > 0)
+				{
+					bytesReceived += count;
+					body.takePayload(count);
+					binaryAdvance(count);
+					checkBodyEnd();
+				}
+				continue;
+			}
+
+			const int count = client.read(buffer, min((size_t)available, sizeof(buffer)));
+			bytesReceived += max(count, 0);
+			for (int i = 0; i < count && isBusy();)
+			{
+				i += receive(buffer + i, count - i);
+			}
+		}
+		readTime += micros() - readStart;
+
+		// a frame already stored can't be gone back to, keeping the image would show it with pixels missing
+		if ((isBusy() || state == DONE) && slot != nullptr && slot->outOfOrder)
+		{
+			Serial.println("image fetch failed, rows arrived for a frame already stored");
+			return fail();
+		}
+		if (state == UNCHANGED && (!keepAlive || !body.finished()))
+			client.stop();
+		if (state == DONE)
+		{
+			// a body not read to its end leaves the connection unusable. an image from the cache before asking never
+			// touched it
+			if (statusParsed && (!keepAlive || !body.finished()))
+				client.stop();
+			if (slot == nullptr)
+				return state;
+			slot->finishImage();
+			if (!cacheHit && !binaryResponse && !gifResponse)
+				imageName = json.imageName;
+			slot->name = imageName;
+			slot->tag = imageTag;
+			// written out by saveToCache(), the flash write would stretch this slice well past its budget. a GIF sent
+			// without a name can't be found again
+			if (!cacheHit && imageName.length() > 0 && cache != nullptr && cache->isEnabled())
+				cache->beginSave(cacheKey(), *slot);
+		}
+		return state;
+	}
+
+private:
+	/**
+	 * set up a new request for `url`, for an image or a document
+	 */
+	bool start(const String &url)
+	{
+		if (!parseUrl(url))
+		{
+			state = FAILED;
+			return false;
+		}
+		slot = nullptr;
+		document = nullptr;
+		documentLength = 0;
+		imageName = "";
+		imageTag = "";
+		knownName = "";
+		knownTag = "";
+		expectedName = "";
+		lineLength = 0;
+		statusParsed = false;
+		responseCode = 0;
+		binaryResponse = false;
+		gifResponse = false;
+		keepAlive = false;
+		chunked = false;
+		contentLength = -1;
+		gzipped = false;
+		cacheHit = false;
+		startTime = millis();
+		bytesReceived = 0;
+		readTime = 0;
+		// the window is only held while a request is in flight
+		acceptGzip = ESP.getFreeHeap() > GzipInflater::windowSize + gzipHeapReserve && inflater.begin();
+		state = CONNECT;
+		lastProgressTime = millis();
+		return true;
+	}
+
+	State fail()
+	{
+		client.stop();
+		state = FAILED;
+		return state;
+	}
+
+	inline bool parsingPayload() const { return state >= META && state <= DOCUMENT; }
+
+	/**
+	 * the payload parsers have the whole image. read on to the end of the body if it's close, so the connection can be reused
+	 */
+	void payloadDone()
+	{
+		state = body.finished() ? DONE : DRAIN;
+		drained = 0;
+	}
+
+	/**
+	 * terminate the document, for the requester to parse in place
+	 */
+	void finishDocument()
+	{
+		if (document != nullptr)
+			document[documentLength] = '\0';
+	}
+
+	void checkBodyEnd()
+	{
+		if (!body.finished())
+			return;
+		if (state == DRAIN)
+		{
+			state = DONE;
+		}
+		else if (state == DOCUMENT)
+		{
+			finishDocument();
+			state = DONE;
+		}
+		else if (parsingPayload())
+		{
+			Serial.println("image fetch failed, response ended before the image did");
+			fail();
+		}
+	}
+
+	/**
+	 * pass received bytes through the header parser, the body framing and any gzip decoding on to the payload parsers.
+	 * returns how many were used
+	 */
+	size_t receive(const uint8_t *data, size_t length)
+	{
+		if (state == HEADERS)
+		{
+			feedHeader((char)data[0]);
+			// an empty body can't hold an image
+			if (state != HEADERS)
+				checkBodyEnd();
+			return 1;
+		}
+
+		if (body.payloadAvailable() == 0)
+		{
+			if (!body.feedFraming(data[0]))
+			{
+				Serial.println("image fetch failed, malformed response body");
+				fail();
+				return 1;
+			}
+			checkBodyEnd();
+			return 1;
+		}
+
+		const size_t count = min(length, body.payloadAvailable());
+		body.takePayload(count);
+		if (state == DRAIN)
+		{
+			drained += count;
+			// too much left, closing the connection is quicker
+			if (drained > drainLimit)
+				state = DONE;
+		}
+		else if (gzipped)
+		{
+			const GzipInflater::Result result = inflater.feed(data, count, [this](uint8_t b)
+			{
+				// anything decoded after the image is complete goes nowhere
+				if (parsingPayload())
+					feed((char)b);
+			});
+			if (result == GzipInflater::ERROR && parsingPayload())
+			{
+				Serial.println("image fetch failed, corrupt gzip data");
+				fail();
+				return count;
+			}
+		}
+		else
+		{
+			for (size_t i = 0; i < count && parsingPayload(); i++)
+				feed((char)data[i]);
+		}
+		checkBodyEnd();
+		return count;
+	}
+
+	/**
+	 * true if a header value contains token, ignoring case
+	 */
+	static bool headerHas(const char *value, const char *token)
+	{
+		const size_t tokenLength = strlen(token);
+		for (; *value; value++)
+		{
+			if (strncasecmp(value, token, tokenLength) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	/**
+	 * images are cached under the size they're stored at, so screens asking for the same size share them whatever their segments
+	 */
+	uint32_t cacheKey() const
+	{
+		const uint16_t width = requestWidth > 0 ? requestWidth : slot->maxWidth;
+		const uint16_t height = requestHeight > 0 ? requestHeight : slot->maxHeight;
+		return ImageCache::keyFor(imageName, slot->fittedWidth(width, height), slot->fittedHeight(width, height));
+	}
+
+	/**
+	 * once the image is named, stop if it's the one the requester already has. the rest of the response is skipped
+	 */
+	bool alreadyHave()
+	{
+		if (knownName.length() == 0 || imageName != knownName)
+			return false;
+		state = UNCHANGED;
+		return true;
+	}
+
+	/**
+	 * once the image is named, load it from the cache if it is there. the rest of the response is then skipped
+	 */
+	bool loadFromCache()
+	{
+		if (cache == nullptr || !cache->isEnabled())
+			return false;
+		cacheHit = cache->load(cacheKey(), *slot, imageName);
+		return cacheHit;
+	}
+
+	bool parseUrl(const String &url)
+	{
+		int hostStart = url.indexOf("://");
+		port = 80;
+		if (hostStart >= 0)
+		{
+			if (url.startsWith("https"))
+				port = 443;
+			hostStart += 3;
+		}
+		else
+		{
+			hostStart = 0;
+		}
+
+		int pathStart = url.indexOf('/', hostStart);
+		if (pathStart < 0)
+			pathStart = url.length();
+		host = url.substring(hostStart, pathStart);
+		path = pathStart < (int)url.length() ? url.substring(pathStart) : String("/");
+
+		const int portStart = host.indexOf(':');
+		if (portStart >= 0)
+		{
+			port = host.substring(portStart + 1).toInt();
+			host = host.substring(0, portStart);
+		}
+		return host.length() > 0;
+	}
+
+	void feedHeader(char c)
+	{
+		if (c == '\r')
+			return;
+		if (c != '\n')
+		{
+			if (lineLength < sizeof(line) - 1)
+				line[lineLength++] = c;
+			return;
+		}
+
+		line[lineLength] = '\0';
+		if (!statusParsed)
+		{
+			// "HTTP/1.1 200 OK"
+			const char *code = strchr(line, ' ');
+			responseCode = code ? atoi(code + 1) : 0;
+			statusParsed = true;
+			// HTTP/1.1 connections stay open unless the server says otherwise
+			keepAlive = strncmp(line, "HTTP/1.1", 8) == 0;
+		}
+		else if (strncasecmp(line, "content-type:", 13) == 0)
+		{
+			// servers that don't know the binary format ignore the request for it and send JSON
+			binaryResponse = strstr(line + 13, "application/octet-stream") != nullptr;
+			gifResponse = strstr(line + 13, "image/gif") != nullptr;
+		}
+		else if (strncasecmp(line, "content-disposition:", 20) == 0)
+		{
+			// a GIF has no name of its own, the server can give it one with filename="…"
+			const char *filename = strstr(line + 20, "filename=");
+			if (filename != nullptr)
+			{
+				filename += 9;
+				const char end = *filename == '"' ? '"' : ';';
+				if (*filename == '"')
+					filename++;
+				const char *last = strchr(filename, end);
+				imageName = last != nullptr ? String(filename).substring(0, last - filename) : String(filename);
+			}
+		}
+		else if (strncasecmp(line, "content-length:", 15) == 0)
+		{
+			contentLength = atol(line + 15);
+		}
+		else if (strncasecmp(line, "transfer-encoding:", 18) == 0)
+		{
+			chunked = headerHas(line + 18, "chunked");
+		}
+		else if (strncasecmp(line, "content-encoding:", 17) == 0)
+		{
+			gzipped = headerHas(line + 17, "gzip");
+		}
+		else if (strncasecmp(line, "connection:", 11) == 0)
+		{
+			keepAlive = headerHas(line + 11, "keep-alive") || (keepAlive && !headerHas(line + 11, "close"));
+		}
+		else if (strncasecmp(line, "etag:", 5) == 0)
+		{
+			const char *value = line + 5;
+			while (*value == ' ')
+				value++;
+			imageTag = value;
+		}
+		else if (lineLength == 0)
+		{
+			// blank line, headers are done. not modified never has a body, a server that ignored If-None-Match
+			// may still send the same tag back, or name a GIF we already have
+			const bool sameImage = (knownTag.length() > 0 && imageTag == knownTag) || (gifResponse && alreadyHave());
+			if (responseCode == 304 || (responseCode == 200 && sameImage))
+			{
+				// the body of a 200 is left unread, so its connection can't be reused
+				body.begin(HttpBody::LENGTH, 0);
+				if (responseCode != 304)
+					keepAlive = false;
+				state = UNCHANGED;
+				lineLength = 0;
+				return;
+			}
+			if (responseCode != 200)
+			{
+				Serial.print("image fetch failed, request returned code ");
+				Serial.println(responseCode);
+				fail();
+				return;
+			}
+			if (gzipped && !acceptGzip)
+			{
+				Serial.println("image fetch failed, gzip response without room to inflate it");
+				fail();
+				return;
+			}
+			// chunked wins over a length, as HTTP/1.1 says
+			if (chunked)
+				body.begin(HttpBody::CHUNKED);
+			else if (contentLength >= 0)
+				body.begin(HttpBody::LENGTH, contentLength);
+			else
+				body.begin(HttpBody::UNTIL_CLOSE);
+			if (document != nullptr)
+			{
+				state = DOCUMENT;
+			}
+			else if (gifResponse)
+			{
+				if (imageName.length() > 0 && loadFromCache())
+				{
+					state = DONE;
+				}
+				else if (gif.begin(slot, usePalette))
+				{
+					state = GIF;
+				}
+				else
+				{
+					Serial.println("image fetch failed, not enough memory to decode a GIF");
+					fail();
+				}
+			}
+			else if (binaryResponse)
+			{
+				state = BINARY_HEADER;
+				binaryBytesRead = 0;
+			}
+			else
+			{
+				state = META;
+				json.begin(slot, usePalette);
+			}
+		}
+		lineLength = 0;
+	}
+
+	void feedBinaryHeader(uint8_t b)
+	{
+		// the fixed header is collected in the line buffer, the path straight after it (truncated if need be)
+		if (binaryBytesRead < sizeof(line) - 1)
+			line[binaryBytesRead] = b;
+		binaryBytesRead++;
+		if (binaryBytesRead == BinaryImageHeader::size)
+		{
+			if (!binaryHeader.read((const uint8_t *)line))
+			{
+				Serial.println("image fetch failed, unrecognised binary image header");
+				fail();
+				return;
+			}
+		}
+		if (binaryBytesRead < BinaryImageHeader::size || binaryBytesRead < BinaryImageHeader::size + binaryHeader.pathLength)
+			return;
+
+		line[min((size_t)binaryBytesRead, sizeof(line) - 1)] = '\0';
+		imageName = String(line + BinaryImageHeader::size);
+		if (alreadyHave())
+			return;
+		if (loadFromCache())
+		{
+			state = DONE;
+			return;
+		}
+		slot->backgroundColour = CRGB(binaryHeader.background[0], binaryHeader.background[1], binaryHeader.background[2]);
+
+		// the arena was sized up front, so this only fits the image to it.
+		// an alpha plane arrives after the colours it belongs to, too late to look pixels up in a palette
+		const bool paletteAllowed = binaryHeader.pixelFormat == BinaryImageHeader::RGBA;
+		slot->beginImage(binaryHeader.frames, binaryHeader.width, binaryHeader.height, usePalette && paletteAllowed, paletteAllowed, true);
+		binaryFrame = 0;
+		startBinaryFrame();
+	}
+
+	void startBinaryFrame()
+	{
+		if (binaryFrame >= binaryHeader.frames || binaryHeader.width == 0 || binaryHeader.height == 0)
+		{
+			payloadDone();
+			return;
+		}
+		state = BINARY_DURATION;
+		binaryBytesRead = 0;
+		binaryX = binaryY = 0;
+		binaryChannel = 0;
+		binaryPlane = 0;
+	}
+
+	void feedBinaryDuration(uint8_t b)
+	{
+		binaryDuration = binaryBytesRead == 0 ? b : binaryDuration | (uint16_t)b << 8;
+		if (++binaryBytesRead == 2)
+		{
+			slot->setDuration(binaryFrame, binaryDuration);
+			state = BINARY_PIXELS;
+		}
+	}
+
+	inline uint8_t binaryChannelsPerPixel() const
+	{
+		if (binaryHeader.pixelFormat == BinaryImageHeader::RGBA)
+			return 4;
+		return binaryPlane == 0 ? 3 : 1;
+	}
+
+	/**
+	 * if the next bytes are RGBA pixels that land in the frame being loaded, point at where they go and return how many are contiguous
+	 */
+	size_t binaryDirectRun(uint8_t *&destination)
+	{
+		if (state != BINARY_PIXELS || binaryHeader.pixelFormat != BinaryImageHeader::RGBA || slot->indexed)
+			return 0;
+		if (!slot->keepsFrame(binaryFrame) || binaryY >= slot->height || binaryX >= slot->width)
+			return 0;
+		CRGBA *row = slot->loadRow(binaryFrame, binaryY);
+		if (row == nullptr)
+			return 0;
+		destination = row[binaryX].raw + binaryChannel;
+		return (size_t)(slot->width - binaryX) * 4 - binaryChannel;
+	}
+
+	/**
+	 * move the pixel position on by count bytes, which must not run past the end of the current row
+	 */
+	void binaryAdvance(size_t count)
+	{
+		const uint8_t channels = binaryChannelsPerPixel();
+		const size_t rowOffset = (size_t)binaryX * channels + binaryChannel + count;
+		binaryX = rowOffset / channels;
+		binaryChannel = rowOffset % channels;
+		if (binaryX < binaryHeader.width)
+			return;
+
+		binaryX = 0;
+		if (++binaryY < binaryHeader.height)
+			return;
+
+		binaryY = 0;
+		if (binaryHeader.pixelFormat == BinaryImageHeader::RGB_ALPHA_PLANE && binaryPlane == 0)
+		{
+			// colour plane done, alpha plane follows
+			binaryPlane = 1;
+			return;
+		}
+
+		binaryFrame++;
+		startBinaryFrame();
+	}
+
+	void feedBinaryPixel(uint8_t b)
+	{
+		if (slot->keepsFrame(binaryFrame) && binaryY < slot->sourceHeight && binaryX < slot->sourceWidth)
+		{
+			if (slot->indexed || (slot->loadScale > 1 && binaryHeader.pixelFormat == BinaryImageHeader::RGBA))
+			{
+				// palette lookups and shrinking need the whole pixel
+				binaryPixel.raw[binaryChannel] = b;
+				if (binaryChannel == 3)
+					slot->setPixel(binaryFrame, binaryX, binaryY, binaryPixel);
+			}
+			else
+			{
+				// an alpha plane arrives after its colours, so a shrinking image keeps one pixel of each square instead
+				const uint8_t channel = binaryPlane == 0 ? binaryChannel : 3;
+				CRGBA *pixel = slot->loadPixel(binaryFrame, binaryX, binaryY);
+				if (pixel != nullptr)
+					pixel->raw[channel] = b;
+			}
+		}
+		binaryAdvance(1);
+	}
+
+	void feed(char c)
+	{
+		switch (state)
+		{
+		case HEADERS:
+			feedHeader(c);
+			break;
+		case META:
+		case ROWS:
+			json.feed(c);
+			switch (json.getPhase())
+			{
+			case PixelJsonParser::ROWS:
+				if (state == META)
+				{
+					imageName = json.imageName;
+					if (alreadyHave())
+						break;
+					if (loadFromCache())
+					{
+						state = DONE;
+						break;
+					}
+				}
+				state = ROWS;
+				break;
+			case PixelJsonParser::DONE:
+				payloadDone();
+				break;
+			case PixelJsonParser::ERROR:
+				fail();
+				break;
+			default:
+				break;
+			}
+			break;
+		case BINARY_HEADER:
+			feedBinaryHeader((uint8_t)c);
+			break;
+		case BINARY_DURATION:
+			feedBinaryDuration((uint8_t)c);
+			break;
+		case BINARY_PIXELS:
+			feedBinaryPixel((uint8_t)c);
+			break;
+		case DOCUMENT:
+			// room is kept for the terminating 0
+			if (documentLength + 1 >= documentCapacity)
+			{
+				Serial.println("document fetch failed, too long for its buffer");
+				fail();
+				break;
+			}
+			document[documentLength++] = c;
+			break;
+		case GIF:
+			gif.feed((uint8_t)c);
+			if (gif.getPhase() == GifDecoder::DONE)
+			{
+				payloadDone();
+			}
+			else if (gif.getPhase() == GifDecoder::ERROR)
+			{
+				Serial.println("image fetch failed, could not decode the GIF");
+				fail();
+			}
+			break;
+		default:
+			break;
+		}
+	}
+};
+
+/// Rolling performance counters, shown in the Info panel and optionally published over MQTT.
+/// Averages are exponential, each new sample counting for an eighth, so they follow the current load without keeping a history
+struct ClientMetrics
+{
+	uint32_t imagesFetched = 0;
+	uint32_t cacheHits = 0;
+	// requests answered with the image already there
+	uint32_t unchanged = 0;
+	uint32_t fetchFailures = 0;
+	// ms from sending the request to the image being ready
+	uint32_t lastFetchTime = 0;
+	uint32_t averageFetchTime = 0;
+	// us of loop() time spent reading and parsing an image
+	uint32_t lastParseTime = 0;
+	uint32_t averageParseTime = 0;
+	uint64_t bytesReceived = 0;
+	uint32_t lastImageBytes = 0;
+	uint32_t averageImageBytes = 0;
+	// us per handleOverlayDraw()
+	uint32_t draws = 0;
+	uint32_t averageDrawTime = 0;
+	// animation frames that went up a whole frame or more late, e.g. held up by a blocking connect
+	uint32_t lateFrames = 0;
+	uint32_t minFreeHeap = UINT32_MAX;
+	// how images were made to fit their slot, by ImageSlot::StoragePlan
+	uint32_t storagePlans[ImageSlot::STORAGE_PLANS] = {};
+	// binary asked for instead of a GIF, to keep the decoder off the heap
+	uint32_t gifFallbacks = 0;
+	// image changes the server pushed over MQTT
+	uint32_t pushes = 0;
+	// playlist manifests fetched, and the requests for one that failed
+	uint32_t manifests = 0;
+	uint32_t manifestFailures = 0;
+
+	static uint32_t average(uint32_t current, uint32_t sample, uint32_t samples)
+	{
+		return samples <= 1 ? sample : (current * 7 + sample) / 8;
+	}
+
+	void imageFetched(const ImageFetch &fetch, const ImageSlot &slot)
+	{
+		imagesFetched++;
+		storagePlans[slot.plan]++;
+		cacheHits += fetch.wasCached();
+		lastFetchTime = fetch.getElapsed();
+		averageFetchTime = average(averageFetchTime, lastFetchTime, imagesFetched);
+		lastParseTime = fetch.getReadTime();
+		averageParseTime = average(averageParseTime, lastParseTime, imagesFetched);
+		lastImageBytes = fetch.getBytesReceived();
+		averageImageBytes = average(averageImageBytes, lastImageBytes, imagesFetched);
+		bytesReceived += lastImageBytes;
+	}
+
+	void fetchFailed(const ImageFetch &fetch)
+	{
+		fetchFailures++;
+		bytesReceived += fetch.getBytesReceived();
+	}
+
+	inline void recordDraw(uint32_t elapsed)
+	{
+		averageDrawTime = average(averageDrawTime, elapsed, ++draws);
+	}
+
+	inline void sampleHeap()
+	{
+		minFreeHeap = min(minFreeHeap, (uint32_t)ESP.getFreeHeap());
+	}
+
+	void toJson(JsonObject out) const
+	{
+		out["images"] = imagesFetched;
+		out["cacheHits"] = cacheHits;
+		out["unchanged"] = unchanged;
+		out["manifests"] = manifests;
+		out["manifestFailures"] = manifestFailures;
+		out["failures"] = fetchFailures;
+		out["fetchMs"] = lastFetchTime;
+		out["avgFetchMs"] = averageFetchTime;
+		out["parseUs"] = lastParseTime;
+		out["avgParseUs"] = averageParseTime;
+		out["kb"] = (uint32_t)(bytesReceived / 1024);
+		out["imageBytes"] = lastImageBytes;
+		out["avgImageBytes"] = averageImageBytes;
+		out["avgDrawUs"] = averageDrawTime;
+		out["lateFrames"] = lateFrames;
+		out["minHeap"] = minFreeHeap;
+		out["fitAsIs"] = storagePlans[ImageSlot::AS_REQUESTED];
+		out["fitPalette"] = storagePlans[ImageSlot::COMPACT];
+		out["fitSkipFrames"] = storagePlans[ImageSlot::SKIP_FRAMES];
+		out["fitTruncated"] = storagePlans[ImageSlot::TRUNCATED];
+		out["gifFallbacks"] = gifFallbacks;
+		out["pushes"] = pushes;
+	}
+};
+
+// class name. Use something descriptive and leave the ": public Usermod" part :)
+class PixelArtClient : public Usermod
+{
+
+private:
+	// Private class members. You can declare variables and functions only accessible to your usermod here
+	bool enabled = false;
+	bool initDone = false;
+	unsigned long lastRequestTime = 0;
+
+	// set your config variables to their boot default value (this can also be done in readFromConfig() or a constructor if you prefer)
+	String serverName = "https://app.pixelart-exchange.au/";
+	String apiKey = "your_api_key";
+	// the screens to show, each on its own 2D segment. the first keeps the config keys from before there were more
+	static const uint8_t maxScreens = 4;
+	String screenIds[maxScreens] = {"WLED"};
+	unsigned int screenSegments[maxScreens] = {};
+	bool transparency = false;
+	bool serverUp = false;
+	long unsigned int serverTestRepeatTime = 10;
+
+	// These config variables have defaults set inside readFromConfig()
+	int testInt;
+	long testLong;
+	int8_t testPins[2];
+	enum CrossfadeEasing : uint8_t
+	{
+		LINEAR,
+		EASE_IN_OUT,
+		EASE_IN,
+		EASE_OUT
+	};
+
+	// crossfades between images run for this long whatever the frame rate, in ms
+	unsigned int crossfadeDuration = 1000;
+	uint8_t crossfadeEasing = LINEAR;
+	// blend amount for each 256th of the crossfade, built from the easing curve when the config changes
+	uint8_t easingTable[256];
+	// upper bound on frames kept per image, the frame arenas are sized from this and the matrix size
+	unsigned int maxFrames = 16;
+	// store images of up to 256 colours as palette indices, fitting 4x the frames
+	bool paletteFrames = true;
+	// ask for the original GIF and decode it here, rather than for the pixels
+	bool gifImages = false;
+	// frames between the ones stored whole, the rest only keep the pixels that changed
+	unsigned int keyframeInterval = 8;
+	// images that aren't the segment's size are scaled to fit it, fill it or sit centred on it
+	uint8_t imageFit = ScaleMap::FIT;
+	// ask the server for images this size whatever the segment, so it draws each one once and the cache holds one copy.
+	// 0 = each segment's own size
+	unsigned int requestSize = 0;
+	// rows of indexed frames are expanded into these to draw them, one row for each image in a crossfade,
+	// a third for the blend of the two and two more for the images scaled to the segment
+	static const uint8_t scratchRowCount = 5;
+	CRGBA *scratchRows = nullptr;
+	CRGB *scratchRgbRows = nullptr;
+	// images kept for each screen: the one showing, the one fading in, those fetched ahead and the one loading
+	static const uint8_t maxImageSlots = 5;
+	// set when the arenas need (re)allocating, e.g. after the config or a segment's size changed
+	bool frameBuffersDirty = true;
+	// images fetched ahead of the one showing, fewer when the heap runs low
+	unsigned int prefetchImages = 2;
+	// heap left for WLED and the network stack, prefetch slots are given up to keep half of it
+	static const uint32_t heapReserve = 32 * 1024;
+	// after a failed request, a screen waits this long before asking again
+	static const unsigned long fetchRetryDelay = 5000;
+	uint8_t pixelArtMode = 255;
+
+	// time betwwen images
+	int duration;
+	// in seconds
+	unsigned int imageDuration = 10;
+
+	HTTPClient http;
+	WiFiClient client;
+	// image requests run through their own connection so a checkin can't disturb one in flight
+	WiFiClient imageClient;
+	ImageFetch fetch{imageClient};
+	// longest a single loop() spends reading and parsing an image, in ms
+	unsigned long fetchSliceTime = 8;
+
+	// images already seen are kept on flash, up to cacheSize KB
+	FileSystemCacheStore cacheStore{"/pixelart"};
+	ImageCache cache{cacheStore};
+	unsigned int cacheSize = 256;
+
+	String playlist;
+
+	ClientMetrics metrics;
+	// publish the metrics to <device topic>/pixelart/metrics this often, in seconds. 0 = off
+	unsigned int metricsInterval = 0;
+	unsigned long metricsPublishTime = 0;
+
+	// with push updates on, each screen subscribes to <push topic>/<screen id> and only fetches when the server says
+	// its image changed there. while MQTT is down the screens go back to fetching every imageDuration
+	bool pushUpdates = false;
+	String pushTopic = "pixelart";
+	// the topic each screen is subscribed to, empty if none. onMqttMessage() reads these on the MQTT client's task, so
+	// one is only written while it's empty and unsubscribed, and its first character goes in last
+	char pushSubscriptions[maxScreens][64] = {};
+	// set from the MQTT client's task when the server pushes a change for a screen, handled on the next loop(). kept
+	// here rather than on the screen, which loop() may delete meanwhile
+	volatile bool pushReceived[maxScreens] = {};
+	// the config changed the topics or MQTT reconnected, resubscribe from loop()
+	volatile bool pushTopicsDirty = true;
+	// MQTT reconnected and the broker may have forgotten the subscriptions, make them all again
+	volatile bool pushResubscribe = false;
+
+	// with a playlist manifest, each screen asks for this many of its upcoming images at once, then fetches them by
+	// id on its own schedule and asks for more as the list runs low. 0 = the server picks each image as it's asked
+	unsigned int manifestImages = 0;
+	static const uint8_t maxManifestImages = 16;
+	// room in the manifest's JSON document for each entry, on top of the list itself
+	static const size_t manifestEntryBytes = 192;
+
+	/// one upcoming image on a screen's playlist, as the manifest lists it
+	struct PlaylistEntry
+	{
+		// asked for with &image=
+		String id;
+		// what the image is called once it loads, and so in the cache, when the manifest gives it as the key. empty
+		// otherwise, the image is only known once its response names it
+		String cacheName;
+		// seconds it stays up, 0 for image duration
+		uint16_t duration = 0;
+	};
+
+	/// one 2D segment showing the images of one screen id, with its own image slots and queue, schedule, frame flips
+	/// and crossfade. the screens take turns with the client's one image request, and share its scratch rows and cache
+	class Screen
+	{
+	public:
+		PixelArtClient &client;
+		// the screen on the server, and the segment it's drawn on
+		String screenId;
+		uint8_t segmentId = 0;
+
+		// the image showing, the one fading in, those fetched ahead and waiting their turn, and the one loading.
+		// as many are allocated as the heap allows, up to 1 + prefetchImages
+		ImageSlot imageSlots[maxImageSlots];
+		// the segment size the slots were allocated for
+		uint16_t frameBufferWidth = 0;
+		uint16_t frameBufferHeight = 0;
+		// scale the image showing and the one fading in to the segment
+		ScaleMap currentMap;
+		ScaleMap nextMap;
+		// the bus index of each pixel of the segment, row by row, so drawing skips the matrix and LED map lookups
+		// strip.setPixelColorXY() repeats for every pixel. rebuilt when any of what it was worked out from moves
+		uint16_t *ledIndices = nullptr;
+		uint16_t ledsLeft = 0;
+		uint16_t ledsTop = 0;
+		uint16_t ledsMatrixWidth = 0;
+		uint16_t ledsMatrixHeight = 0;
+		bool ledsOnMatrix = false;
+		const uint16_t *ledsMap = nullptr;
+		uint16_t ledsMapSize = 0;
+		// a new LED map the same size as the old one can be loaded where the old one was, so the indices are
+		// worked out again this often even when nothing else moved
+		static const unsigned long ledsCheckInterval = 1000;
+		unsigned long ledsCheckTime = 0;
+
+		ImageSlot *currentImage = nullptr;
+		ImageSlot *nextImage = nullptr;
+		ImageSlot *loadingImage = nullptr;
+		// loaded and waiting to be shown, oldest first
+		ImageSlot *readyImages[maxImageSlots];
+		uint8_t readyCount = 0;
+		// when the next image is due on, so fetching ahead keeps the swaps on time
+		unsigned long nextImageTime = 0;
+		// after a failed request, wait until this before the next
+		unsigned long fetchRetryTime = 0;
+		// a pushed change still to fetch, and to show as soon as it arrives
+		bool fetchPushed = false;
+		bool showPushed = false;
+		// entries from the playlist manifest still to fetch, in order, and where the server's list carries on from
+		PlaylistEntry playlistEntries[maxManifestImages];
+		uint8_t playlistCount = 0;
+		String playlistCursor;
+		// the server has no manifest, so the screen asks it for each image until the config changes
+		bool manifestUnsupported = false;
+		// after a failed manifest request, or one that left the list short, wait until this before the next
+		unsigned long manifestRetryTime = 0;
+
+		int currentFrameIndex = 0;
+		// within the image, we may have one or more frames
+		FrameView currentFrame;
+		unsigned int currentFrameDuration;
+		unsigned long refreshTime = 0;
+		// within the next image,cache the first frame for a transition
+		FrameView nextFrame;
+		bool crossfading = false;
+		unsigned long crossfadeStart = 0;
+		// blend amount last drawn, a crossfade only redraws when the amount changes
+		uint8_t drawnBlend = 0;
+		// what changed with the last frame flip, so a redraw can skip the pixels already on the LEDs
+		FrameChanges frameChanges;
+		// set when the LEDs may not hold the last frame drawn, e.g. after a crossfade or while another effect runs
+		bool redrawAll = true;
+		uint8_t drawnBrightness = 0;
+		bool imageLoaded = false;
+		String name;
+
+		Screen(PixelArtClient &owner) : client(owner) {}
+
+		/**
+		 * forget every image and let go of the slots. the screen is sized for its segment as it is now, even if
+		 * nothing gets allocated, so a segment too big to fit isn't retried every loop
+		 */
+		void reset()
+		{
+			imageLoaded = false;
+			crossfading = false;
+			currentFrame = FrameView();
+			nextFrame = FrameView();
+			redrawAll = true;
+			currentImage = nextImage = loadingImage = nullptr;
+			readyCount = 0;
+			fetchRetryTime = millis();
+			fetchPushed = showPushed = false;
+			dropPlaylist();
+			manifestUnsupported = false;
+			manifestRetryTime = millis();
+			for (ImageSlot &slot : imageSlots)
+			{
+				slot.release();
+				slot.flattenOnLoad = !client.transparency;
+				slot.keyframeInterval = client.keyframeInterval;
+			}
+			currentMap.release();
+			nextMap.release();
+			free(ledIndices);
+			ledIndices = nullptr;
+			frameBufferWidth = segmentWidth(segmentId);
+			frameBufferHeight = segmentHeight(segmentId);
+		}
+
+		/**
+		 * one slot to show and one to load into, the prefetch slots only come once every screen has these
+		 */
+		bool allocate()
+		{
+			if (screenId.length() == 0 || frameBufferWidth == 0 || frameBufferHeight == 0)
+				return false;
+			ledIndices = (uint16_t *)malloc((size_t)frameBufferWidth * frameBufferHeight * sizeof(uint16_t));
+			// built on the first draw
+			ledsMatrixWidth = 0;
+			if (ledIndices != nullptr && currentMap.allocate(frameBufferWidth, frameBufferHeight) && nextMap.allocate(frameBufferWidth, frameBufferHeight) &&
+				imageSlots[0].allocate(client.maxFrames, frameBufferWidth, frameBufferHeight) && imageSlots[1].allocate(client.maxFrames, frameBufferWidth, frameBufferHeight))
+				return true;
+			imageSlots[0].release();
+			imageSlots[1].release();
+			currentMap.release();
+			nextMap.release();
+			free(ledIndices);
+			ledIndices = nullptr;
+			Serial.print("Pixel art client could not allocate frame buffers for segment ");
+			Serial.print(segmentId);
+			Serial.print(", ");
+			Serial.print(client.maxFrames);
+			Serial.println(" frames, try lowering max frames");
+			return false;
+		}
+
+		inline bool isAllocated() const { return imageSlots[0].arena.bytes() > 0; }
+
+		/**
+		 * work out ledIndices again if the segment moved on the matrix or the LED map changed, the same way
+		 * strip.setPixelColorXY() maps each pixel. pixels off the matrix get an index no bus has
+		 */
+		void mapLeds()
+		{
+			const Segment &segment = strip.getSegment(segmentId);
+			if (segment.start == ledsLeft && segment.startY == ledsTop && Segment::maxWidth == ledsMatrixWidth && Segment::maxHeight == ledsMatrixHeight &&
+				strip.isMatrix == ledsOnMatrix && strip.customMappingTable == ledsMap && strip.customMappingSize == ledsMapSize && millis() - ledsCheckTime < ledsCheckInterval)
+				return;
+			ledsCheckTime = millis();
+			ledsLeft = segment.start;
+			ledsTop = segment.startY;
+			ledsMatrixWidth = Segment::maxWidth;
+			ledsMatrixHeight = Segment::maxHeight;
+			ledsOnMatrix = strip.isMatrix;
+			ledsMap = strip.customMappingTable;
+			ledsMapSize = strip.customMappingSize;
+			bool moved = false;
+			for (uint16_t y = 0; y < frameBufferHeight; y++)
+			{
+				for (uint16_t x = 0; x < frameBufferWidth; x++)
+				{
+					uint16_t index = UINT16_MAX;
+					if (ledsOnMatrix && ledsLeft + x < ledsMatrixWidth && ledsTop + y < ledsMatrixHeight)
+					{
+						index = (ledsTop + y) * ledsMatrixWidth + ledsLeft + x;
+						if (index < ledsMapSize)
+							index = ledsMap[index];
+					}
+					uint16_t &led = ledIndices[(size_t)y * frameBufferWidth + x];
+					moved |= led != index;
+					led = index;
+				}
+			}
+			// pixels now on other LEDs are drawn again, even where the image hasn't changed
+			if (moved)
+				redrawAll = true;
+		}
+
+		inline const uint16_t *ledRow(uint16_t y) const { return ledIndices + (size_t)y * frameBufferWidth; }
+
+		static inline void setLed(uint16_t index, const CRGB &colour) { busses.setPixelColor(index, RGBW32(colour.r, colour.g, colour.b, 0)); }
+
+		static inline CRGB getLed(uint16_t index) { return CRGB(busses.getPixelColor(index)); }
+
+		/**
+		 * write a whole row of the segment straight to the buses
+		 */
+		void blitRow(uint16_t y, const CRGB *colours)
+		{
+			const uint16_t *leds = ledRow(y);
+			for (uint16_t x = 0; x < frameBufferWidth; x++)
+			{
+				setLed(leds[x], colours[x]);
+			}
+		}
+
+		/**
+		 * true if the segment was resized, moved to another size or turned off since the slots were allocated
+		 */
+		bool sizeChanged() const
+		{
+			return frameBufferWidth != segmentWidth(segmentId) || frameBufferHeight != segmentHeight(segmentId);
+		}
+
+		uint8_t imageSlotCount()
+		{
+			uint8_t count = 0;
+			for (ImageSlot &slot : imageSlots)
+				count += slot.arena.bytes() > 0;
+			return count;
+		}
+
+		/**
+		 * allocate one more prefetch slot, if the config wants one and the heap can spare it
+		 */
+		bool addImageSlot()
+		{
+			if (!isAllocated() || imageSlotCount() >= min(1 + client.prefetchImages, (unsigned int)maxImageSlots))
+				return false;
+			if (ESP.getFreeHeap() < heapReserve + ImageSlot::footprint(client.maxFrames, frameBufferWidth, frameBufferHeight))
+				return false;
+			for (ImageSlot &slot : imageSlots)
+			{
+				if (slot.arena.bytes() == 0)
+					return slot.allocate(client.maxFrames, frameBufferWidth, frameBufferHeight);
+			}
+			return false;
+		}
+
+		/**
+		 * true if the slot is showing, fading in, waiting its turn or loading
+		 */
+		bool imageSlotInUse(const ImageSlot *slot)
+		{
+			if (slot == currentImage || slot == nextImage || slot == loadingImage)
+				return true;
+			for (uint8_t i = 0; i < readyCount; i++)
+			{
+				if (readyImages[i] == slot)
+					return true;
+			}
+			return false;
+		}
+
+		/**
+		 * an allocated slot the next image can load into, or nullptr if they're all taken
+		 */
+		ImageSlot *freeImageSlot()
+		{
+			for (ImageSlot &slot : imageSlots)
+			{
+				if (slot.arena.bytes() > 0 && !imageSlotInUse(&slot))
+					return &slot;
+			}
+			return nullptr;
+		}
+
+		/**
+		 * give up a prefetch slot when the heap runs low, and take it back once there's room again.
+		 * the thresholds are more than a slot apart so this doesn't flap
+		 */
+		void balancePrefetch()
+		{
+			if (ESP.getFreeHeap() >= heapReserve / 2)
+			{
+				if (addImageSlot())
+				{
+					Serial.print("heap recovered, segment ");
+					Serial.print(segmentId);
+					Serial.print(" prefetching ");
+					Serial.print(imageSlotCount() - 1);
+					Serial.println(" images");
+				}
+				return;
+			}
+			// the first two slots came with the frame buffers and are never given up, so there's always one to show
+			// and one to load into. an empty prefetch slot goes first, otherwise the one that would have been shown last
+			ImageSlot *victim = nullptr;
+			for (uint8_t i = 2; i < maxImageSlots && victim == nullptr; i++)
+			{
+				if (imageSlots[i].arena.bytes() > 0 && !imageSlotInUse(&imageSlots[i]))
+					victim = &imageSlots[i];
+			}
+			for (uint8_t i = readyCount; i-- > 0 && victim == nullptr;)
+			{
+				if (readyImages[i] < imageSlots + 2)
+					continue;
+				victim = readyImages[i];
+				memmove(readyImages + i, readyImages + i + 1, (readyCount - i - 1) * sizeof(ImageSlot *));
+				readyCount--;
+			}
+			if (victim == nullptr)
+				return;
+			victim->release();
+			Serial.print("heap low, segment ");
+			Serial.print(segmentId);
+			Serial.print(" prefetching ");
+			Serial.print(imageSlotCount() - 1);
+			Serial.println(" images");
+		}
+
+		/**
+		 * called once the requested image is fully parsed into loadingImage.
+		 * one that went on early while it loaded is already showing, otherwise it joins the queue
+		 */
+		void imageReceived()
+		{
+			if (loadingImage != currentImage && loadingImage != nextImage)
+				readyImages[readyCount++] = loadingImage;
+			loadingImage = nullptr;
+			fetchPushed = false;
+			Serial.print("requestImageFrames new image: ");
+			Serial.print(name);
+			Serial.print(", ");
+			Serial.print(readyCount);
+			Serial.println(" waiting");
+		}
+
+		/**
+		 * the image the server handed out last that's still here: the back of the queue, or the one showing.
+		 * asking for the next one, the server can answer that it's this one again
+		 */
+		const ImageSlot *newestImage() const
+		{
+			if (readyCount > 0)
+				return readyImages[readyCount - 1];
+			if (nextImage != nullptr)
+				return nextImage;
+			return imageLoaded ? currentImage : nullptr;
+		}
+
+		/**
+		 * called when the server's next image is the newest one already here. nothing joins the queue and nothing
+		 * fades, the image showing plays on as if it had just gone up again, for the `duration` the request was made
+		 * with. ask again once its time is up, or straight away for the next playlist entry
+		 */
+		void imageUnchanged(uint16_t duration)
+		{
+			dropLoadingImage();
+			fetchPushed = false;
+			showPushed = false;
+			if (!imageLoaded)
+			{
+				fetchRetryTime = millis() + fetchRetryDelay;
+				return;
+			}
+			if ((long)(millis() - nextImageTime) >= 0)
+				nextImageTime = millis() + entrySeconds(duration) * 1000UL;
+			// the next playlist entry can be fetched ahead now, the server's next image only once this one is due
+			if (!scheduledLocally() || playlistCount == 0)
+				fetchRetryTime = nextImageTime;
+		}
+
+		/**
+		 * called when the request for loadingImage fails, the screen waits a while before asking again
+		 */
+		void imageFailed()
+		{
+			dropLoadingImage();
+			fetchRetryTime = millis() + fetchRetryDelay;
+		}
+
+		void dropLoadingImage()
+		{
+			// an incomplete image must not be queued, but one already showing keeps the frames that arrived
+			if (loadingImage == currentImage || loadingImage == nextImage)
+				loadingImage->abandonImage();
+			else
+				loadingImage->frameCount = 0;
+			loadingImage = nullptr;
+		}
+
+		/**
+		 * true if the screen works through a playlist manifest on its own schedule, rather than the server picking
+		 * each image as it's asked
+		 */
+		inline bool scheduledLocally() const { return client.manifestImages > 0 && !manifestUnsupported; }
+
+		/**
+		 * true once the list is too short to keep prefetching from, time to ask for more
+		 */
+		inline bool playlistLow() const { return playlistCount <= min(client.prefetchImages, client.manifestImages / 2); }
+
+		inline uint16_t entrySeconds(uint16_t duration) const { return duration > 0 ? duration : client.imageDuration; }
+
+		/**
+		 * add an entry from the manifest to the end of the list. one that repeats the entry before it only makes
+		 * that one stay up longer
+		 */
+		bool addPlaylistEntry(const String &id, const String &cacheName, uint16_t duration)
+		{
+			if (playlistCount > 0 && playlistEntries[playlistCount - 1].id == id)
+			{
+				PlaylistEntry &last = playlistEntries[playlistCount - 1];
+				last.duration = min((uint32_t)entrySeconds(last.duration) + entrySeconds(duration), (uint32_t)UINT16_MAX);
+				return true;
+			}
+			if (playlistCount >= maxManifestImages)
+				return false;
+			PlaylistEntry &entry = playlistEntries[playlistCount++];
+			entry.id = id;
+			entry.cacheName = cacheName;
+			entry.duration = duration;
+			return true;
+		}
+
+		/**
+		 * take the next entry off the front of the list
+		 */
+		PlaylistEntry takePlaylistEntry()
+		{
+			const PlaylistEntry entry = playlistEntries[0];
+			playlistCount--;
+			for (uint8_t i = 0; i < playlistCount; i++)
+				playlistEntries[i] = playlistEntries[i + 1];
+			return entry;
+		}
+
+		void dropPlaylist()
+		{
+			playlistCount = 0;
+			playlistCursor = "";
+		}
+
+		/**
+		 * the next entry is the image showing, with nothing else lined up after it: leave it up for the entry's
+		 * time too, rather than fetch it again and fade to itself. only an entry with a key can be told apart
+		 * before it's asked for, the server answers unchanged for any other
+		 */
+		bool repeatImage(const PlaylistEntry &entry)
+		{
+			if (!imageLoaded || readyCount > 0 || nextImage != nullptr || loadingImage != nullptr || entry.cacheName.length() == 0 || currentImage->name != entry.cacheName)
+				return false;
+			nextImageTime += entrySeconds(entry.duration) * 1000UL;
+			return true;
+		}
+
+		/**
+		 * the server says this screen's image or playlist changed: what was fetched ahead is out of date, so drop it,
+		 * and the manifest too, and fetch the new one to go up as soon as it arrives. the client cancels the request
+		 * in flight first if it's ours
+		 */
+		void imagePushed()
+		{
+			readyCount = 0;
+			dropPlaylist();
+			fetchPushed = true;
+			showPushed = true;
+			fetchRetryTime = millis();
+		}
+
+		/**
+		 * the image to fade to when the current one's time is up: the front of the queue, or with nothing queued
+		 * the one loading, as soon as its first frame is complete. the rest of its frames join playback as they arrive
+		 */
+		ImageSlot *upcomingImage()
+		{
+			if (readyCount > 0)
+				return readyImages[0];
+			if (loadingImage != nullptr && loadingImage != currentImage && loadingImage->playableFrames() > 0)
+				return loadingImage;
+			return nullptr;
+		}
+
+		/**
+		 * the next image goes on when its time comes, or straight away if nothing is showing yet. with push updates
+		 * the image showing stays until the server pushes a change, unless the screen keeps its own schedule from a
+		 * manifest. a pushed image goes on as soon as it arrives
+		 */
+		void update()
+		{
+			if (upcomingImage() == nullptr || crossfading)
+				return;
+			const bool onSchedule = !client.pushActive() || scheduledLocally();
+			const bool due = showPushed || (onSchedule && (long)(millis() - nextImageTime) >= 0);
+			if (!imageLoaded || due)
+				showNextImage();
+		}
+
+		/**
+		 * take the upcoming image and fade to it
+		 */
+		void showNextImage()
+		{
+			nextImage = upcomingImage();
+			showPushed = false;
+			if (readyCount > 0 && nextImage == readyImages[0])
+			{
+				readyCount--;
+				memmove(readyImages, readyImages + 1, readyCount * sizeof(ImageSlot *));
+			}
+
+			// swaps on time keep to the schedule, a late one (nothing was ready) starts it again
+			const unsigned long now = millis();
+			const unsigned long imageTime = entrySeconds(nextImage->duration) * 1000UL;
+			nextImageTime = (imageLoaded && now - nextImageTime < imageTime) ? nextImageTime + imageTime : now + imageTime;
+
+			// prime these for next redraw
+			if (imageLoaded)
+			{
+				// we have 2 images, crossfade them
+				crossfading = true;
+				crossfadeStart = millis();
+				redrawAll = true;
+				nextFrame = nextImage->seek(0);
+			}
+			else
+			{
+				// first load? just show it;
+				imageLoaded = true;
+				refreshTime = millis();
+				completeImageTransition();
+			}
+		}
+
+		void completeImageTransition()
+		{
+			// the image that was showing is free for the next load
+			currentImage = nextImage;
+			nextImage = nullptr;
+
+			currentFrameIndex = 0;
+			currentFrame = currentImage->seek(currentFrameIndex);
+			currentFrameDuration = currentImage->durations[currentFrameIndex];
+			redrawAll = true;
+		}
+
+		/**
+		 * draw currently cached image again, flipping frames and stepping the crossfade as they come due.
+		 * false if there was nothing to draw
+		 */
+		bool draw()
+		{
+			// the slots no longer fit the segment, they're reallocated on the next loop
+			if (!imageLoaded || sizeChanged())
+				return false;
+			mapLeds();
+
+			// an image still loading may have moved its frames to fit more colours
+			if (currentFrame.layout != currentImage->layoutVersion)
+			{
+				currentFrameIndex = min(currentFrameIndex, currentImage->playableFrames() - 1);
+				currentFrame = currentImage->seek(currentFrameIndex);
+				redrawAll = true;
+			}
+			if (crossfading && nextFrame.layout != nextImage->layoutVersion)
+				nextFrame = nextImage->seek(0);
+
+			// cycle frames within a multi-frame image (ie animated gif)
+			bool flipped = false;
+			const unsigned long sinceFlip = millis() - refreshTime;
+			if (sinceFlip > currentFrameDuration)
+			{
+				// a whole frame behind, the animation visibly stalled
+				if (currentImage->playableFrames() > 1 && currentFrameDuration > 0 && sinceFlip >= 2 * currentFrameDuration)
+					client.metrics.lateFrames++;
+				refreshTime = millis();
+				currentFrameIndex++;
+				// only frames that have fully arrived, if the image is still loading
+				currentFrameIndex = currentFrameIndex % currentImage->playableFrames();
+				// choose next frame in set to update
+				currentFrame = currentImage->seek(currentFrameIndex, &frameChanges);
+				currentFrameDuration = currentImage->durations[currentFrameIndex];
+				flipped = true;
+			}
+
+			const unsigned long crossfadeTime = millis() - crossfadeStart;
+			if (crossfading && crossfadeTime >= client.crossfadeDuration)
+			{
+				crossfading = false;
+				completeImageTransition();
+			}
+
+			// the LEDs still hold the last thing drawn unless something else drew over them, or the brightness changed
+			// (which rescales what the bus holds)
+			const bool ownsSegment = strip.getSegment(segmentId).mode == client.pixelArtMode;
+			const bool ledsHoldLastDraw = !redrawAll && !client.transparency && ownsSegment && strip.getBrightness() == drawnBrightness;
+
+			if (crossfading)
+			{
+				// eased by how far through the crossfade we are, so it takes the same time at any frame rate
+				const uint8_t blendAmount = client.easingTable[crossfadeTime * 256 / client.crossfadeDuration];
+				// skip steps that wouldn't change anything on the LEDs
+				if (blendAmount != drawnBlend || flipped || !ledsHoldLastDraw)
+					setPixelsFrom2DVector(currentFrame, nextFrame, blendAmount, currentImage->backgroundColour, nextImage->backgroundColour);
+				drawnBlend = blendAmount;
+			}
+			else
+			{
+				// only the pixels that changed with the flip need setting, if they're drawn as they are
+				if (ledsHoldLastDraw && !frameChanges.all && currentMap.identity)
+					setPixelsFromChanges(currentFrame, frameChanges, currentImage->backgroundColour);
+				else
+					setPixelsFrom2DVector(currentFrame, currentImage->backgroundColour);
+
+				// drawn, nothing changes until the next flip
+				frameChanges = FrameChanges();
+				frameChanges.all = false;
+			}
+			redrawAll = !ownsSegment;
+			drawnBrightness = strip.getBrightness();
+			return true;
+		}
+
+		/**
+		 * row y of the segment from a frame, through its scale map. `scratch` takes the frame's own row if it needs
+		 * expanding, and `scaled` the row as the segment sees it. pixels the image doesn't reach are transparent
+		 */
+		const CRGBA *segmentRow(const FrameView &frame, const ScaleMap &map, uint16_t y, CRGBA *scratch, CRGBA *scaled)
+		{
+			if (map.identity)
+				return frame.row(y, scratch);
+			const CRGBA *row = map.rows[y] < 0 ? nullptr : frame.row(map.rows[y], scratch);
+			for (uint16_t x = 0; x < map.width; x++)
+			{
+				scaled[x] = row == nullptr || map.columns[x] < 0 ? CRGBA(0, 0, 0, 0) : row[map.columns[x]];
+			}
+			return scaled;
+		}
+
+		/**
+		 * the same for a flattened frame, where the image doesn't reach is its background
+		 */
+		const CRGB *segmentRgbRow(const FrameView &frame, const ScaleMap &map, uint16_t y, CRGB *scratch, CRGB *scaled, CRGB background)
+		{
+			if (map.identity)
+				return frame.rgbRow(y, scratch);
+			const CRGB *row = map.rows[y] < 0 ? nullptr : frame.rgbRow(map.rows[y], scratch);
+			for (uint16_t x = 0; x < map.width; x++)
+			{
+				scaled[x] = row == nullptr || map.columns[x] < 0 ? background : row[map.columns[x]];
+			}
+			return scaled;
+		}
+
+		// frames are scaled to the segment and written through its LED indices
+		void setPixelsFrom2DVector(const FrameView &pixelValues, CRGB backgroundColour)
+		{
+			currentMap.build(pixelValues.width, pixelValues.height, (ScaleMap::Fit)client.imageFit);
+			if (pixelValues.flattened && !client.transparency)
+			{
+				// already composited onto the background when it loaded, just copy it out
+				CRGB *scaled = client.scratchRgbRows + 3 * frameBufferWidth;
+				for (int whichRow = 0; whichRow < currentMap.height; whichRow++)
+				{
+					blitRow(whichRow, segmentRgbRow(pixelValues, currentMap, whichRow, client.scratchRgbRows, scaled, backgroundColour));
+				}
+				return;
+			}
+			if (client.transparency && currentMap.identity && pixelValues.spans != nullptr)
+			{
+				setPixelsFromSpans(pixelValues);
+				return;
+			}
+
+			// iterate through the frame's rows of CRGBA values
+			CRGBA *scaled = client.scratchRows + 3 * frameBufferWidth;
+			for (int whichRow = 0; whichRow < currentMap.height; whichRow++)
+			{
+				const CRGBA *row = segmentRow(pixelValues, currentMap, whichRow, client.scratchRows, scaled);
+				const uint16_t *leds = ledRow(whichRow);
+				for (int whichCol = 0; whichCol < currentMap.width; whichCol++)
+				{
+					CRGBA pixel = row[whichCol];
+					CRGB finalColour;
+					if (client.transparency)
+					{
+						// the effect shows through, nothing to set
+						if (pixel.a == 0)
+							continue;
+						CRGB existing = pixel.a == 255 ? CRGB() : getLed(leds[whichCol]);
+						finalColour = flatten(pixel, existing);
+					}
+					else
+					{
+						finalColour = flatten(pixel, backgroundColour);
+					}
+					setLed(leds[whichCol], finalColour);
+				}
+			}
+		}
+
+		/**
+		 * overlay a frame drawn pixel for pixel, a coverage run at a time: see-through runs are left to the effect,
+		 * opaque ones written without reading the LEDs back, and only the partly transparent pixels blended
+		 */
+		void setPixelsFromSpans(const FrameView &pixelValues)
+		{
+			const uint8_t *span = pixelValues.spans;
+			for (uint16_t whichRow = 0; whichRow < pixelValues.height; whichRow++)
+			{
+				const uint16_t *leds = ledRow(whichRow);
+				// rows that are all see-through are never expanded
+				const CRGBA *row = nullptr;
+				for (uint16_t whichCol = 0; whichCol < pixelValues.width; span++)
+				{
+					const uint8_t length = CoverageRun::length(*span);
+					const CoverageRun::Coverage coverage = CoverageRun::coverage(*span);
+					if (coverage != CoverageRun::CLEAR && row == nullptr)
+						row = pixelValues.row(whichRow, client.scratchRows);
+					if (coverage == CoverageRun::OPAQUE)
+					{
+						for (uint16_t x = whichCol; x < whichCol + length; x++)
+						{
+							setLed(leds[x], CRGB(row[x].r, row[x].g, row[x].b));
+						}
+					}
+					else if (coverage == CoverageRun::PARTIAL)
+					{
+						for (uint16_t x = whichCol; x < whichCol + length; x++)
+						{
+							CRGBA pixel = row[x];
+							CRGB existing = getLed(leds[x]);
+							setLed(leds[x], flatten(pixel, existing));
+						}
+					}
+					whichCol += length;
+				}
+			}
+		}
+
+		/**
+		 * set only the runs of pixels that changed with the last frame flip, the rest are already on the LEDs.
+		 * only for frames drawn pixel for pixel
+		 */
+		void setPixelsFromChanges(const FrameView &pixelValues, const FrameChanges &changes, CRGB backgroundColour)
+		{
+			for (uint16_t i = 0; i < changes.count; i++)
+			{
+				const FrameRun run = changes.run(i);
+				const uint16_t *leds = ledRow(run.y);
+				for (uint16_t whichCol = run.x; whichCol < run.x + run.length; whichCol++)
+				{
+					// flattened pixels are opaque, so this is a copy for them
+					CRGBA pixel = pixelValues.pixel(whichCol, run.y);
+					setLed(leds[whichCol], flatten(pixel, backgroundColour));
+				}
+			}
+		}
+
+		void setPixelsFrom2DVector(const FrameView &currentPixels, const FrameView &nextPixels, uint8_t blendPercent, CRGB &backgroundColour, CRGB nextBackgroundColour)
+		{
+			currentMap.build(currentPixels.width, currentPixels.height, (ScaleMap::Fit)client.imageFit);
+			nextMap.build(nextPixels.width, nextPixels.height, (ScaleMap::Fit)client.imageFit);
+
+			// iterate through both frames row by row, each scaled to the segment so the two line up whatever their sizes
+			const int rows = currentMap.height;
+			const int cols = currentMap.width;
+			const uint16_t stride = frameBufferWidth;
+			// a row at a time through the packed blend, into the third scratch row
+			if (currentPixels.flattened && nextPixels.flattened && !client.transparency)
+			{
+				// both opaque already, so blend the colours with no alpha to carry or flatten
+				CRGB *blended = client.scratchRgbRows + 2 * stride;
+				for (int whichRow = 0; whichRow < rows; whichRow++)
+				{
+					const CRGB *row = segmentRgbRow(currentPixels, currentMap, whichRow, client.scratchRgbRows, client.scratchRgbRows + 3 * stride, backgroundColour);
+					const CRGB *targetRow = segmentRgbRow(nextPixels, nextMap, whichRow, client.scratchRgbRows + stride, client.scratchRgbRows + 4 * stride, nextBackgroundColour);
+					blendBytes(row->raw, targetRow->raw, blended->raw, cols * sizeof(CRGB), blendPercent);
+					blitRow(whichRow, blended);
+				}
+				return;
+			}
+			CRGBA *blended = client.scratchRows + 2 * stride;
+			for (int whichRow = 0; whichRow < rows; whichRow++)
+			{
+				const CRGBA *row = segmentRow(currentPixels, currentMap, whichRow, client.scratchRows, client.scratchRows + 3 * stride);
+				const CRGBA *targetRow = segmentRow(nextPixels, nextMap, whichRow, client.scratchRows + stride, client.scratchRows + 4 * stride);
+				blendBytes(row->raw, targetRow->raw, blended->raw, cols * sizeof(CRGBA), blendPercent);
+				const uint16_t *leds = ledRow(whichRow);
+				for (int whichCol = 0; whichCol < cols; whichCol++)
+				{
+					CRGB finalColour;
+					if (client.transparency)
+					{
+						if (blended[whichCol].a == 0)
+							continue;
+						CRGB existing = blended[whichCol].a == 255 ? CRGB() : getLed(leds[whichCol]);
+						finalColour = flatten(blended[whichCol], existing);
+					}
+					else
+					{
+						finalColour = flatten(blended[whichCol], backgroundColour);
+					}
+					setLed(leds[whichCol], finalColour);
+				}
+			}
+		}
+	};
+
+	// the first screen always exists, the rest only take memory once they're given a screen id
+	Screen firstScreen{*this};
+	Screen *screens[maxScreens] = {&firstScreen};
+	// the screen the image in flight is for, and the one to ask for an image first next time
+	Screen *fetchingScreen = nullptr;
+	uint8_t nextFetchScreen = 0;
+	// the manifest in flight is read into this through the same fetch, and parsed once it's all there
+	char *manifestBuffer = nullptr;
+
+	// string that are used multiple time (this will save some flash memory)
+	static const char _name[];
+	static const char _enabled[];
+
+	// any private methods should go here (non-inline methosd should be defined out of class)
+	void publishMqtt(const char *topic, const char *state, bool retain = false);
+
+public:
+	// non WLED related methods, may be used for data exchange between usermods (non-inline methods should be defined out of class)
+
+	/**
+	 * Enable/Disable the usermod
+	 */
+	inline void enable(bool enable) { enabled = enable; }
+
+	/**
+	 * Get usermod enabled/disabled state
+	 */
+	inline bool isEnabled() { return enabled; }
+
+	// in such case add the following to another usermod:
+	//  in private vars:
+	//   #ifdef USERMOD_EXAMPLE
+	//   MyExampleUsermod* UM;
+	//   #endif
+	//  in setup()
+	//   #ifdef USERMOD_EXAMPLE
+	//   UM = (MyExampleUsermod*) usermods.lookup(USERMOD_ID_EXAMPLE);
+	//   #endif
+	//  somewhere in loop() or other member method
+	//   #ifdef USERMOD_EXAMPLE
+	//   if (UM != nullptr) isExampleEnabled = UM->isEnabled();
+	//   if (!isExampleEnabled) UM->enable(true);
+	//   #endif
+
+
+
+
+
+	static uint16_t dummyEffect()
+	{
+		return FRAMETIME;
+	}
+
+	static uint16_t mode_pixelart(void)
+	{
+		return PixelArtClient::dummyEffect();
+	}
+
+	/**
+	 * a segment's size on the matrix, 0 if it's gone or turned off
+	 */
+	static uint16_t segmentWidth(uint8_t segmentId)
+	{
+		return segmentId < strip.getSegmentsNum() ? strip.getSegment(segmentId).width() : 0;
+	}
 
+	static uint16_t segmentHeight(uint8_t segmentId)
+	{
+		return segmentId < strip.getSegmentsNum() ? strip.getSegment(segmentId).height() : 0;
+	}
 
+	/**
+	 * config key for one of a screen's settings, the first screen keeps the keys it had before there were more
+	 */
+	static String screenKey(uint8_t screen, const char *setting)
+	{
+		if (screen == 0)
+			return strcmp(setting, "id") == 0 ? String("screen id") : String(setting);
+		return String("screen ") + (screen + 1) + " " + setting;
+	}
 
+	/**
+	 * bring the screens in line with the config, size the load buffers and scratch rows shared between them for the
+	 * largest segment, then give each screen its image slots, as many as fit up to 1 + prefetchImages.
+	 * only called when the config or a segment's size changes, every image after that reuses the same buffers
+	 */
+	bool allocateFrameBuffers()
+	{
+		frameBuffersDirty = false;
+		// the image in flight, or one waiting for the cache, may be in a slot that's about to go
+		fetch.reset();
+		fetch.cancelSave();
+		fetchingScreen = nullptr;
+		endManifest();
+
+		uint16_t width = 0;
+		uint16_t height = 0;
+		for (uint8_t i = 0; i < maxScreens; i++)
+		{
+			if (i > 0 && screenIds[i].length() == 0)
+			{
+				delete screens[i];
+				screens[i] = nullptr;
+				continue;
+			}
+			if (screens[i] == nullptr)
+				screens[i] = new (std::nothrow) Screen(*this);
+			if (screens[i] == nullptr)
+				continue;
+			screens[i]->screenId = screenIds[i];
+			screens[i]->segmentId = screenSegments[i];
+			// anything still pointing into the old buffers is gone
+			screens[i]->reset();
+			if (screenIds[i].length() > 0)
+			{
+				width = max(width, screens[i]->frameBufferWidth);
+				height = max(height, screens[i]->frameBufferHeight);
+			}
+		}
 
+		free(scratchRows);
+		free(scratchRgbRows);
+		scratchRows = nullptr;
+		scratchRgbRows = nullptr;
+		ImageSlot::releaseLoadBuffers();
+		if (width == 0 || height == 0)
+		{
+			Serial.println("Pixel art client has no 2D segment to draw on");
+			return false;
+		}
+		scratchRows = (CRGBA *)malloc((size_t)width * scratchRowCount * sizeof(CRGBA));
+		scratchRgbRows = (CRGB *)malloc((size_t)width * scratchRowCount * sizeof(CRGB));
+		// rows of images asked for at a bigger size arrive whole before they're shrunk
+		bool allocated = scratchRows != nullptr && scratchRgbRows != nullptr && ImageSlot::allocateLoadBuffers(width, height) && fetch.allocate(max(width, (uint16_t)requestSize));
+		if (!allocated)
+		{
+			ImageSlot::releaseLoadBuffers();
+			Serial.println("Pixel art client could not allocate its load buffers");
+			return false;
+		}
 
-	static uint16_t dummyEffect()
+		// every screen gets one to show and one to load into before any of them prefetch
+		for (Screen *screen : screens)
+		{
+			if (screen != nullptr)
+				screen->allocate();
+		}
+		// then the rest a round at a time, while they leave the reserve free
+		bool added = true;
+		while (added)
+		{
+			added = false;
+			for (Screen *screen : screens)
+			{
+				if (screen != nullptr)
+					added |= screen->addImageSlot();
+			}
+		}
+		for (Screen *screen : screens)
+		{
+			if (screen == nullptr || !screen->isAllocated())
+				continue;
+			Serial.print("frame buffers allocated for segment ");
+			Serial.print(screen->segmentId);
+			Serial.print(", ");
+			Serial.print(screen->imageSlotCount());
+			Serial.print(" images of ");
+			Serial.print(screen->imageSlots[0].arena.bytes());
+			Serial.println(" bytes");
+		}
+		Serial.print("remaining heap: ");
+		Serial.println(ESP.getFreeHeap(), DEC);
+		return true;
+	}
+
+	/**
+	 * true if the arenas no longer match the config or a segment's size
+	 */
+	bool frameBuffersNeedAllocating()
 	{
-		return FRAMETIME;
+		if (frameBuffersDirty)
+			return true;
+		for (Screen *screen : screens)
+		{
+			if (screen != nullptr && screen->sizeChanged())
+				return true;
+		}
+		return false;
 	}
 
-	static uint16_t mode_pixelart(void)
+	/**
+	 * percent-encode a value for a query string
+	 */
+	static String urlEncode(const String &value)
 	{
-		return PixelArtClient::dummyEffect();
+		static const char hex[] = "0123456789ABCDEF";
+		String encoded;
+		encoded.reserve(value.length());
+		for (size_t i = 0; i < value.length(); i++)
+		{
+			const char c = value[i];
+			if (isalnum((unsigned char)c) || c == '-' || c == '_' || c == '.' || c == '~')
+			{
+				encoded += c;
+				continue;
+			}
+			encoded += '%';
+			encoded += hex[(uint8_t)c >> 4];
+			encoded += hex[c & 0x0f];
+		}
+		return encoded;
 	}
 
-	void requestImageFrames()
+	void requestImageFrames(Screen &screen, ImageSlot *slot, const PlaylistEntry *entry = nullptr)
 	{
 		// Your Domain name with URL path or IP address with path
-
-
-		currentImage = imageIndex ? &image1 : &image2;
-		nextImage = imageIndex ? &image2 : &image1;
-		currentImageDurations = imageIndex ? &image1durations : &image2durations;
-		nextImageDurations = imageIndex ? &image2durations : &image1durations;
 		const String serverPath = "api/image/pixels";
-		const String clientPhrase = "screen_id=" + clientName;
+		const String clientPhrase = "screen_id=" + screen.screenId;
 		const String keyPhrase = "&key=" + apiKey;
 
-		const String width = String(strip._segments[strip.getCurrSegmentId()].maxWidth);
-		const String height = String(strip._segments[strip.getCurrSegmentId()].maxHeight);
-		const String getUrl = serverName + (serverName.endsWith("/") ? "" : "/") + serverPath + "?" + clientPhrase + keyPhrase + "&width=" + width + "&height=" + height;
+		const uint16_t requestWidth = requestSize > 0 ? requestSize : screen.frameBufferWidth;
+		const uint16_t requestHeight = requestSize > 0 ? requestSize : screen.frameBufferHeight;
+		const String width = String(requestWidth);
+		const String height = String(requestHeight);
+		// decoding a GIF takes heap the binary payload doesn't, ask for that instead if it would eat into the reserve.
+		// GIF frames build on each other at their full size, so one bigger than the segment can't be shrunk as it loads
+		const bool gifFits = requestWidth <= screen.frameBufferWidth && requestHeight <= screen.frameBufferHeight;
+		const bool askForGif = gifImages && gifFits && ESP.getFreeHeap() >= heapReserve + GifDecoder::workingBytes(requestWidth, requestHeight);
+		if (gifImages && gifFits && !askForGif)
+		{
+			metrics.gifFallbacks++;
+			Serial.println("not enough heap to decode a GIF, asking for binary");
+		}
+		// the server can answer unchanged rather than send the newest image here again
+		const ImageSlot *newest = screen.newestImage();
+		const String havePhrase = newest != nullptr && newest->name.length() > 0 ? "&have=" + urlEncode(newest->name) : String();
+		// an entry from the manifest is asked for by id, rather than whatever the server would send next
+		const String imagePhrase = entry != nullptr ? "&image=" + urlEncode(entry->id) : String();
+		// ask for the compact binary payload or the GIF itself, servers without them ignore this and send JSON
+		const String getUrl = serverName + (serverName.endsWith("/") ? "" : "/") + serverPath + "?" + clientPhrase + keyPhrase + "&width=" + width + "&height=" + height + (askForGif ? "&format=gif" : "&format=binary") + imagePhrase + havePhrase;
 		;
 
 		Serial.print("requestImageFrames: ");
 		Serial.println(getUrl);
-		http.begin(client, (getUrl).c_str());
 
-		// Send HTTP GET request, turn back to http 1.0 for streaming
-		http.useHTTP10(true);
-		int httpResponseCode = http.GET();
-		// Serial.print("HTTP Response code: ");
-		// Serial.println(httpResponseCode);
-		if (httpResponseCode != 200)
+		// the response is read a slice at a time from loop(), see pollImageFrames()
+		screen.loadingImage = slot;
+		fetchingScreen = &screen;
+		fetch.begin(getUrl, slot, paletteFrames, requestWidth, requestHeight);
+		if (newest != nullptr)
+			fetch.skipIfUnchanged(newest->name, newest->tag);
+		slot->duration = entry != nullptr ? entry->duration : 0;
+		// without a key the cache is looked in once the response names the image
+		if (entry != nullptr && entry->cacheName.length() > 0)
+			fetch.expectImage(entry->cacheName);
+	}
+
+	/**
+	 * ask the server for the screen's next playlist entries, carrying on from the ones it already has. made once for
+	 * a list's worth of images rather than for each one, and read a slice at a time like an image, see pollManifest()
+	 */
+	void requestManifest(Screen &screen)
+	{
+		const uint16_t requestWidth = requestSize > 0 ? requestSize : screen.frameBufferWidth;
+		const uint16_t requestHeight = requestSize > 0 ? requestSize : screen.frameBufferHeight;
+		const uint8_t wanted = min(manifestImages, (unsigned int)maxManifestImages) - screen.playlistCount;
+		const String cursorPhrase = screen.playlistCursor.length() > 0 ? "&from=" + urlEncode(screen.playlistCursor) : String();
+		const String getUrl = serverName + (serverName.endsWith("/") ? "" : "/") + "api/image/manifest?screen_id=" + screen.screenId + "&key=" + apiKey +
+							  "&width=" + String(requestWidth) + "&height=" + String(requestHeight) + "&count=" + String(wanted) + cursorPhrase;
+		Serial.print("requestManifest: ");
+		Serial.println(getUrl);
+
+		const size_t capacity = manifestBytes(wanted);
+		manifestBuffer = (char *)malloc(capacity);
+		if (manifestBuffer == nullptr || !fetch.beginDocument(getUrl, manifestBuffer, capacity))
 		{
-			Serial.print("image fetch failed, request returned code ");
-			Serial.println(httpResponseCode);
-			http.end();
+			endManifest();
+			manifestFailed(screen);
 			return;
 		}
-		// payload = http.getStream();
+		fetchingScreen = &screen;
+	}
 
-		// Serial.print("total stream length: ");
-		// Serial.println(http.getString().length());
+	/**
+	 * room for a manifest of `entries` images, the text and the JSON document parsed from it each take this much
+	 */
+	static size_t manifestBytes(uint8_t entries) { return 256 + entries * manifestEntryBytes; }
 
-		// Serial.print("parseResponse() start: remaining heap: ");
-		// Serial.println(ESP.getFreeHeap(), DEC);
+	/**
+	 * let the manifest's buffer go, once it's parsed or the request is given up
+	 */
+	void endManifest()
+	{
+		free(manifestBuffer);
+		manifestBuffer = nullptr;
+	}
 
-		DynamicJsonDocument doc(2048);
-		Stream &client = http.getStream();
+	/**
+	 * try again in a while, and until then the screen waits rather than have the server pick its images
+	 */
+	void manifestFailed(Screen &screen)
+	{
+		metrics.manifestFailures++;
+		screen.manifestRetryTime = millis() + fetchRetryDelay;
+	}
 
-		client.find("\"meta\"");
-		client.find(":");
-		// meta
-		DeserializationError error = deserializeJson(doc, client);
+	/**
+	 * advance the manifest request by one time slice, and take the entries from it once it's all there
+	 */
+	void pollManifest()
+	{
+		Screen &screen = *fetchingScreen;
+		const ImageFetch::State state = fetch.advance(fetchSliceTime);
+		if (state != ImageFetch::DONE && state != ImageFetch::FAILED)
+			return;
+		fetch.reset();
+		fetchingScreen = nullptr;
+		if (state == ImageFetch::FAILED)
+		{
+			endManifest();
+			if (fetch.getResponseCode() == 404)
+			{
+				screen.manifestUnsupported = true;
+				Serial.println("server has no playlist manifest, asking for each image");
+				return;
+			}
+			Serial.print("manifest fetch failed, request returned code ");
+			Serial.println(fetch.getResponseCode());
+			manifestFailed(screen);
+			return;
+		}
 
+		const uint8_t wanted = min(manifestImages, (unsigned int)maxManifestImages) - screen.playlistCount;
+		DynamicJsonDocument doc(manifestBytes(wanted));
+		// parsed in place, the entries' strings are copied out before the buffer goes
+		const DeserializationError error = deserializeJson(doc, manifestBuffer, fetch.getDocumentLength());
 		if (error)
 		{
-			Serial.print("deserializeJson() failed: ");
+			endManifest();
+			Serial.print("manifest deserializeJson() failed: ");
 			Serial.println(error.c_str());
-			imageLoaded = false;
+			manifestFailed(screen);
 			return;
 		}
 
-		const unsigned int totalFrames = doc["frames"];
-		nextImageBackgroundColour = hexToCRGB(doc["backgroundColor"]);
-		const unsigned int returnHeight = doc["height"];
-		const unsigned int returnWidth = doc["width"];
-		const char *path = doc["path"]; // "ms-pacman.gif"
-		name = String(path);
-
-		Serial.print("nextImage.resize: ");
-		Serial.println(totalFrames);
-		(*nextImage).resize(totalFrames);
-
-		Serial.print("nextImage.size: ");
-		Serial.println((*nextImage).size());
-
-		for (size_t i = 0; i < totalFrames; i++)
+		// frame counts and sizes come again in each image's own header, before any of its pixels, which is where
+		// the slot is fitted to them
+		for (JsonObject image : doc["images"].as<JsonArray>())
 		{
-			(*nextImage)[i].resize(returnHeight);
-			Serial.print("nextImage[i].resize: ");
-			Serial.println(returnHeight);
-			for (size_t j = 0; j < returnHeight; j++)
-			{
-				Serial.print("nextImage[i][j].resize: ");
-				Serial.println(returnWidth);
-				(*nextImage)[i][j].resize(returnWidth);
-			}
+			const char *id = image["id"] | "";
+			if (*id == '\0')
+				continue;
+			if (!screen.addPlaylistEntry(id, image["key"] | "", image["duration"] | 0))
+				break;
 		}
+		screen.playlistCursor = doc["next"] | "";
+		endManifest();
+		metrics.manifests++;
+		Serial.print("manifest for screen ");
+		Serial.print(screen.screenId);
+		Serial.print(", ");
+		Serial.print(screen.playlistCount);
+		Serial.println(" images to come");
+		// asking again straight away would only get the same short list
+		if (screen.playlistLow())
+			screen.manifestRetryTime = millis() + fetchRetryDelay;
+	}
 
-		nextImageDurations->resize(totalFrames);
-
-		client.find("\"rows\"");
-		client.find("[");
-		do
+	/**
+	 * advance the in-flight image request by one time slice.
+	 * a finished image joins the back of its screen's queue, one the screen already has changes nothing
+	 */
+	void pollImageFrames()
+	{
+		Screen &screen = *fetchingScreen;
+		switch (fetch.advance(fetchSliceTime))
 		{
-			DeserializationError error = deserializeJson(doc, client);
-			// ...extract values from the document...
-
-			// Serial.print("pixelsJson.size: ");
-			// Serial.println(rowPixels.size());
-
-			// read row metadata
-			int frame_duration = doc["duration"]; // 200, 200, 200
-			int frameIndex = doc["frame"];		  // 200, 200, 200
-			(*nextImageDurations)[frameIndex] = frame_duration;
-			int rowIndex = doc["row"]; // 200, 200, 200
-
-			// const JsonArray rows = frame["pixels"];
-
-			JsonArray rowPixels = doc["pixels"].as<JsonArray>();
-			int colIndex = 0;
-
-			(*nextImage)[frameIndex][rowIndex].resize(returnWidth);
+		case ImageFetch::DONE:
+			fetch.reset();
+			fetchingScreen = nullptr;
+			screen.name = fetch.imageName;
+			Serial.print(fetch.wasCached() ? "requestImageFrames finished from cache, remaining heap: " : "requestImageFrames finished, remaining heap: ");
+			Serial.println(ESP.getFreeHeap(), DEC);
+			metrics.imageFetched(fetch, *screen.loadingImage);
+			screen.imageReceived();
+			break;
+		case ImageFetch::UNCHANGED:
+			fetch.reset();
+			fetchingScreen = nullptr;
+			metrics.unchanged++;
+			Serial.println("requestImageFrames: image unchanged");
+			screen.imageUnchanged(screen.loadingImage->duration);
+			break;
+		case ImageFetch::FAILED:
+			fetch.reset();
+			fetchingScreen = nullptr;
+			metrics.fetchFailed(fetch);
+			screen.imageFailed();
+			break;
+		default:
+			break;
+		}
+	}
 
-			for (JsonVariant pixel : rowPixels)
+	/**
+	 * start the next image request, for the first screen after the last one served that has a free slot,
+	 * so a screen prefetching ahead can't keep the others waiting
+	 */
+	void fetchNextImage()
+	{
+		for (uint8_t i = 0; i < maxScreens; i++)
+		{
+			const uint8_t which = (nextFetchScreen + i) % maxScreens;
+			Screen *screen = screens[which];
+			if (screen == nullptr || (long)(millis() - screen->fetchRetryTime) < 0)
+				continue;
+			// with push updates a screen only fetches when told to, or to have something to show, unless it keeps its
+			// own schedule from a manifest
+			if (pushActive() && !screen->scheduledLocally() && !screen->fetchPushed && (screen->imageLoaded || screen->readyCount > 0))
+				continue;
+			ImageSlot *slot = screen->freeImageSlot();
+			if (slot == nullptr)
+				continue;
+			if (screen->scheduledLocally() && screen->playlistLow() && (long)(millis() - screen->manifestRetryTime) >= 0)
 			{
-				const char *pixelStr = (pixel.as<const char *>());
-				const CRGBA color = hexToCRGBA(String(pixelStr));\
-				(*nextImage)[frameIndex][rowIndex][colIndex] = color;
-				colIndex++;
+				nextFetchScreen = which + 1;
+				requestManifest(*screen);
+				return;
 			}
-
-		} while (client.findUntil(",", "]"));
-
-		// Free resources
-		http.end();
-
-		if (error)
-		{
-			Serial.print("deserializeJson() failed: ");
-			Serial.println(error.c_str());
-			imageLoaded = false;
+			// a screen keeping its own schedule waits for its manifest, rather than have the server pick
+			if (screen->scheduledLocally() && screen->playlistCount == 0)
+				continue;
+			nextFetchScreen = which + 1;
+			Serial.println("in loop, getting image");
+			getImage(*screen, slot);
 			return;
 		}
-
-		nextImageFrameCount = totalFrames;
-
-		// imageDuration = doc["duration"];		// 10
-		// JsonArray framesJson = doc["frames"].as<JsonArray>();
-		// Serial.print("framesJson.size: ");
-		// Serial.println(framesJson.size());
-
-		// Once the values have been parsed, resize the frames vector to the appropriate size
-
-		// int frameIndex = 0;
-		// for (JsonObject frame : framesJson)
-		// {
-		// 	// parse a frame, which is rows > column nested arrays
-
-		// 	int frame_duration = frame["duration"]; // 200, 200, 200
-		// 	const JsonArray rows = frame["pixels"];
-		// 	int totalRows = rows.size();
-		// 	int rowIndex = 0;
-		// 	(*nextImageDurations)[frameIndex] = frame_duration;
-		// 	(*nextImage)[frameIndex].resize(totalRows);
-
-		// 	for (JsonArray column : rows)
-		// 	{
-		// 		// int totalColumns = column.size();
-		// 		int colIndex = 0;
-		// 		(*nextImage)[frameIndex][rowIndex].resize(totalRows);
-		// 		for (JsonVariant pixel : column)
-		// 		{
-		// 			const char *pixelStr = (pixel.as<const char *>());
-		// 			const CRGB color = hexToCRGB(String(pixelStr));
-		// 			(*nextImage)[frameIndex][rowIndex][colIndex] = color;
-		// 			colIndex++;
-		// 		}
-		// 		rowIndex++;
-		// 	}
-		// 	frameIndex++;
-		// }
-		// nextImageFrameCount = totalFrames;
-
-		Serial.print("parseResponse() done: remaining heap: ");
-		Serial.println(ESP.getFreeHeap(), DEC);
-		imageLoaded = true;
-
-		Serial.print("requestImageFrames finished, remaining heap: ");
-		Serial.println(ESP.getFreeHeap(), DEC);
-		// return payload;
 	}
 
-	CRGB hexToCRGB(String hexString)
+	/**
+	 * true while pushes can arrive, otherwise the screens fetch on their own schedule
+	 */
+	bool pushActive()
 	{
-		// Convert the hex string to an integer value
-		uint32_t hexValue = strtoul(hexString.c_str(), NULL, 16);
-
-		// Extract the red, green, and blue components from the hex value
-		uint8_t red = (hexValue >> 16) & 0xFF;
-		uint8_t green = (hexValue >> 8) & 0xFF;
-		uint8_t blue = hexValue & 0xFF;
-
-		// Create a CRGB object with the extracted components
-		CRGB color = CRGB(red, green, blue);
-
-		return color;
+#ifndef WLED_DISABLE_MQTT
+		return pushUpdates && WLED_MQTT_CONNECTED;
+#else
+		return false;
+#endif
 	}
-	CRGBA hexToCRGBA(String hexString)
-	{
-		// Convert the hex string to an integer value
-		uint32_t hexValue = strtoul(hexString.c_str(), NULL, 16);
-
-		// Extract the red, green, and blue components from the hex value
-		uint8_t red = (hexValue >> 24) & 0xFF;
-		uint8_t green = (hexValue >> 16) & 0xFF;
-		uint8_t blue = (hexValue >> 8) & 0xFF;
-		uint8_t alpha = hexValue & 0xFF;
-
-		// Create a CRGB object with the extracted components
-		CRGBA color = CRGBA(red, green, blue, alpha);
 
-		return color;
+	/**
+	 * bring the push topics in line with the screen ids, unsubscribing from any that changed
+	 */
+	void subscribePushTopics()
+	{
+#ifndef WLED_DISABLE_MQTT
+		if (!WLED_MQTT_CONNECTED)
+			return;
+		pushTopicsDirty = false;
+		if (pushResubscribe)
+		{
+			pushResubscribe = false;
+			for (char *subscription : pushSubscriptions)
+				subscription[0] = '\0';
+		}
+		for (uint8_t i = 0; i < maxScreens; i++)
+		{
+			char *subscription = pushSubscriptions[i];
+			const String topic = pushUpdates && screenIds[i].length() > 0 ? pushTopic + "/" + screenIds[i] : String();
+			if (topic == subscription)
+				continue;
+			if (subscription[0] != '\0')
+			{
+				// emptied first, so a message still on its way for the old topic matches nothing from here on
+				char old[sizeof(pushSubscriptions[i])];
+				strcpy(old, subscription);
+				subscription[0] = '\0';
+				mqtt->unsubscribe(old);
+			}
+			if (topic.length() == 0)
+				continue;
+			if (topic.length() >= sizeof(pushSubscriptions[i]))
+			{
+				Serial.print("push topic too long, not subscribed: ");
+				Serial.println(topic);
+				continue;
+			}
+			strcpy(subscription + 1, topic.c_str() + 1);
+			subscription[0] = topic[0];
+			mqtt->subscribe(subscription, 0);
+		}
+#endif
 	}
 
-	void parseResponse(std::vector<std::vector<std::vector<CRGB>>> &frames, const Stream &response, String playlist, String &pathStr, int &durationInt)
+	/**
+	 * act on the pushes received since the last loop. a screen whose image is in flight starts that request again
+	 */
+	void handlePushes()
 	{
-
-		;
-		// path, playlist,duration, totalFrame
-
-		// char* input;
-		// size_t inputLength; (optional)
+		for (uint8_t i = 0; i < maxScreens; i++)
+		{
+			Screen *screen = screens[i];
+			if (!pushReceived[i])
+				continue;
+			pushReceived[i] = false;
+			if (screen == nullptr)
+				continue;
+			metrics.pushes++;
+			if (fetchingScreen == screen)
+			{
+				fetch.reset();
+				fetchingScreen = nullptr;
+				if (manifestBuffer != nullptr)
+					endManifest();
+				else
+					screen->dropLoadingImage();
+			}
+			screen->imagePushed();
+			Serial.print("image change pushed for screen ");
+			Serial.println(screen->screenId);
+		}
 	}
 
-	void completeImageTransition()
+	/**
+	 * blend amount for each step of a crossfade, looked up per draw instead of evaluating the curve
+	 */
+	void buildEasingTable()
 	{
-
-		// flip to the next image for the next request
-		imageIndex = imageIndex == 0 ? 1 : 0;
-		// and flip which image is which, so nextImage -> currentImage
-		// used in next redraw
-		currentImage = imageIndex ? &image1 : &image2;
-		currentImageDurations = imageIndex ? &image1durations : &image2durations;
-
-		// reuse this for the next image load
-		nextImage = imageIndex ? &image2 : &image1;
-		nextImageDurations = imageIndex ? &image2durations : &image1durations;
-		currentImageFrameCount = nextImageFrameCount;
-		currentImageBackgroundColour = nextImageBackgroundColour;
-
-		currentFrameIndex = 0;
-		currentFrame = (*currentImage)[currentFrameIndex];
-		currentFrameDuration = (*currentImageDurations)[currentFrameIndex];
+		for (int i = 0; i < 256; i++)
+		{
+			const float t = i / 255.0f;
+			float eased;
+			switch (crossfadeEasing)
+			{
+			case EASE_IN_OUT:
+				eased = t * t * (3 - 2 * t);
+				break;
+			case EASE_IN:
+				eased = t * t;
+				break;
+			case EASE_OUT:
+				eased = t * (2 - t);
+				break;
+			default:
+				eased = t;
+				break;
+			}
+			easingTable[i] = eased * 255 + 0.5f;
+		}
 	}
 
-	void getImage()
+	void getImage(Screen &screen, ImageSlot *slot)
 	{
 		Serial.print("getImage() start: remaining heap: ");
 		Serial.println(ESP.getFreeHeap(), DEC);
-		// Send request
-		requestImageFrames();
-
-		//	String playlist;
-		//	String name;
-		Serial.print("getImage() after requestImageFrames: remaining heap: ");
-		Serial.println(ESP.getFreeHeap(), DEC);
-
-		// parseResponse(frames, rawResponse, playlist, name, duration);
-
-		Serial.print("requestImageFrames new image: ");
-		Serial.println(name);
-
-		// prime these for next redraw
-		if (imageLoaded)
+		// the next entry from the manifest, if there is one. without, the server picks
+		if (screen.scheduledLocally() && screen.playlistCount > 0)
 		{
-			if (image1.size() > 0 && image2.size() > 0)
-			{
-				// we have 2 images, crossfade them
-				nextBlend = crossfadeIncrement;
-				nextFrame = (*nextImage)[0];
-			}
-			else
+			const PlaylistEntry entry = screen.takePlaylistEntry();
+			if (screen.repeatImage(entry))
 			{
-				// first load? just show it;
-				completeImageTransition();
+				metrics.unchanged++;
+				Serial.println("getImage(): next entry is the image showing, leaving it up");
+				return;
 			}
+			requestImageFrames(screen, slot, &entry);
+			return;
 		}
+		// Send request, the response is parsed over the following loops
+		requestImageFrames(screen, slot);
 	}
 
 	// methods called by WLED (can be inlined as they are called only once but if you call them explicitly define them out of class)
@@ -548,21 +6128,40 @@ public:
 		Serial.print("Hello from pixel art grabber! WLED matrix mode on? ");
 		Serial.println(strip.isMatrix);
 		initDone = true;
-		strip.addEffect(255, &PixelArtClient::mode_pixelart, "Pixel Art@Transition Speed;;;2");
+		pixelArtMode = strip.addEffect(255, &PixelArtClient::mode_pixelart, "Pixel Art@Transition Speed;;;2");
+		// the filesystem is mounted by now
+		cache.begin((size_t)cacheSize * 1024);
+		fetch.setCache(&cache);
+		// checkins keep their connection open for the next one, if the server allows it. set once here, nothing
+		// else uses this HTTPClient
+		http.setReuse(true);
 	}
 
+	/**
+	 * check each screen in, with the size of its segment
+	 */
 	void checkin()
 	{
-		const String width = String(strip._segments[strip.getCurrSegmentId()].maxWidth);
-		const String height = String(strip._segments[strip.getCurrSegmentId()].maxHeight);
-		const String getUrl = serverName + (serverName.endsWith("/") ? "api/client/checkin?id=" : "/api/client/checkin?id=") + clientName + "&width=" + width + "&height=" + height;
+		serverUp = true;
+		for (uint8_t i = 0; i < maxScreens; i++)
+		{
+			if (screenIds[i].length() > 0)
+				serverUp &= checkin(screenIds[i], screenSegments[i]);
+		}
+	}
+
+	bool checkin(const String &screenId, uint8_t segmentId)
+	{
+		const String width = String(segmentWidth(segmentId));
+		const String height = String(segmentHeight(segmentId));
+		const String getUrl = serverName + (serverName.endsWith("/") ? "api/client/checkin?id=" : "/api/client/checkin?id=") + screenId + "&width=" + width + "&height=" + height;
 		Serial.println(getUrl);
 		http.begin(client, (getUrl).c_str());
 
 		// Send HTTP GET request
 		int httpResponseCode = http.GET();
-		serverUp = (httpResponseCode == 200);
-		if (!serverUp)
+		const bool checkedIn = (httpResponseCode == 200);
+		if (!checkedIn)
 		{
 			Serial.print("Pixel art client failed to checkin, request returned ");
 			Serial.println(httpResponseCode);
@@ -572,6 +6171,7 @@ public:
 			Serial.print("Pixel art client checked in OK");
 		}
 		http.end();
+		return checkedIn;
 	}
 
 	/*
@@ -613,69 +6213,59 @@ public:
 			return;
 		}
 
-		// request next image
-		if (millis() - lastRequestTime > imageDuration * 1000)
+		if (frameBuffersNeedAllocating())
+			allocateFrameBuffers();
+
+		// nowhere to put an image, wait for the config to change
+		if (scratchRows == nullptr)
+			return;
+
+		metrics.sampleHeap();
+		for (Screen *screen : screens)
 		{
-			Serial.println("in loop, getting image");
-			lastRequestTime = millis();
-			getImage();
+			if (screen != nullptr)
+				screen->balancePrefetch();
+		}
+		if (pushTopicsDirty)
+			subscribePushTopics();
+		handlePushes();
+
+		// a new image goes to the cache a piece per pass, before the next download starts. otherwise keep reading the
+		// image in flight, a slice per loop so redraws carry on
+		if (fetch.hasPendingSave())
+			fetch.saveToCache();
+		else if (fetch.isBusy() && manifestBuffer != nullptr)
+			pollManifest();
+		else if (fetch.isBusy())
+			pollImageFrames();
+
+		for (Screen *screen : screens)
+		{
+			if (screen != nullptr)
+				screen->update();
 		}
-	}
 
-	void setPixelsFrom2DVector(const std::vector<std::vector<CRGBA>> &pixelValues, CRGB backgroundColour)
-	{
+		// keep the queues topped up while the current images play
+		if (!fetch.isBusy())
+			fetchNextImage();
 
-		// iterate through the 2D vector of CRGBA values
-		int whichRow = 0;
-		for (std::vector<CRGBA> row : pixelValues)
+		if (metricsInterval > 0 && millis() - metricsPublishTime >= metricsInterval * 1000UL)
 		{
-			int whichCol = 0;
-			for (CRGBA pixel : row)
-			{
-				CRGB finalColour;
-				if (transparency)
-				{
-					CRGB existing = strip.getPixelColorXY(whichCol, whichRow);
-					finalColour = flatten(pixel, existing);
-				}
-				else
-				{
-					finalColour = flatten(pixel, backgroundColour);
-				}
-				strip.setPixelColorXY(whichCol, whichRow, finalColour);
-				whichCol++;
-			}
-			whichRow++;
+			metricsPublishTime = millis();
+			publishMetrics();
 		}
 	}
 
-	void setPixelsFrom2DVector(std::vector<std::vector<CRGBA>> &currentPixels, std::vector<std::vector<CRGBA>> &nextPixels, int &blendPercent, CRGB &backgroundColour)
+	/**
+	 * the metrics as JSON, to <device topic>/pixelart/metrics
+	 */
+	void publishMetrics()
 	{
-
-		// iterate through the 2D vector of CRGB values
-		int whichRow = 0;
-		for (std::vector<CRGBA> row : currentPixels)
-		{
-			int whichCol = 0;
-			for (CRGBA pixel : row)
-			{
-				const CRGBA targetPixel = nextFrame[whichRow][whichCol];
-				CRGBA newPixel = blend_a(pixel, targetPixel, blendPercent);
-				CRGB finalColour;
-				if (transparency)
-				{
-				CRGB existing = strip.getPixelColorXY(whichCol, whichRow);
-				 finalColour = flatten(newPixel, existing);
-				}
-				else
-				{
-					finalColour = flatten(newPixel, backgroundColour);
-				}
-				strip.setPixelColorXY(whichCol, whichRow, finalColour);
-				whichCol++;
-			}
-			whichRow++;
-		}
+		StaticJsonDocument<512> doc;
+		metrics.toJson(doc.to<JsonObject>());
+		char payload[576];
+		serializeJson(doc, payload, sizeof(payload));
+		publishMqtt("metrics", payload);
 	}
 
 	/*
@@ -690,18 +6280,48 @@ public:
 		if (user.isNull())
 			user = root.createNestedObject("u");
 
-		// this code adds "u":{"ExampleUsermod":[20," lux"]} to the info object
-		// int reading = 20;
-		// JsonArray lightArr = user.createNestedArray(FPSTR(_name))); //name
-		// lightArr.add(reading); //value
-		// lightArr.add(F(" lux")); //unit
+		// each row is [value, unit]
+		JsonArray images = user.createNestedArray(F("Pixel art images"));
+		images.add(metrics.imagesFetched);
+		images.add(String(F(" fetched, ")) + metrics.cacheHits + F(" from cache, ") + metrics.unchanged + F(" unchanged, ") + metrics.fetchFailures + F(" failed"));
+
+		JsonArray fetchTime = user.createNestedArray(F("Pixel art fetch"));
+		fetchTime.add(metrics.lastFetchTime);
+		fetchTime.add(String(F(" ms, average ")) + metrics.averageFetchTime + F(" ms"));
+
+		JsonArray parseTime = user.createNestedArray(F("Pixel art parse"));
+		parseTime.add(metrics.lastParseTime / 1000);
+		parseTime.add(String(F(" ms, average ")) + metrics.averageParseTime / 1000 + F(" ms"));
+
+		JsonArray received = user.createNestedArray(F("Pixel art data"));
+		received.add(metrics.averageImageBytes / 1024);
+		received.add(String(F(" KB per image, ")) + (uint32_t)(metrics.bytesReceived / 1024) + F(" KB in all"));
+
+		JsonArray drawTime = user.createNestedArray(F("Pixel art draw"));
+		drawTime.add(metrics.averageDrawTime);
+		drawTime.add(String(F(" us, ")) + metrics.lateFrames + F(" late frames"));
 
-		// if you are implementing a sensor usermod, you may publish sensor data
-		// JsonObject sensor = root[F("sensor")];
-		// if (sensor.isNull()) sensor = root.createNestedObject(F("sensor"));
-		// temp = sensor.createNestedArray(F("light"));
-		// temp.add(reading);
-		// temp.add(F("lux"));
+		JsonArray storage = user.createNestedArray(F("Pixel art storage"));
+		storage.add(metrics.storagePlans[ImageSlot::AS_REQUESTED]);
+		storage.add(String(F(" as is, ")) + metrics.storagePlans[ImageSlot::COMPACT] + F(" as palette, ") + metrics.storagePlans[ImageSlot::SKIP_FRAMES] +
+					F(" skipping frames, ") + metrics.storagePlans[ImageSlot::TRUNCATED] + F(" cut short, ") + metrics.gifFallbacks + F(" binary for GIF"));
+
+		JsonArray updates = user.createNestedArray(F("Pixel art updates"));
+		updates.add(pushActive() ? metrics.pushes : imageDuration);
+		updates.add((pushActive() ? String(F(" pushed over MQTT")) : String(F(" s polling"))) + (manifestImages > 0 ? String(F(", ")) + metrics.manifests + F(" manifests") : String()));
+
+		JsonArray heap = user.createNestedArray(F("Pixel art min heap"));
+		heap.add(metrics.minFreeHeap == UINT32_MAX ? 0 : metrics.minFreeHeap);
+		heap.add(F(" bytes"));
+
+		for (uint8_t i = 0; i < maxScreens; i++)
+		{
+			if (screens[i] == nullptr || screens[i]->screenId.length() == 0)
+				continue;
+			JsonArray screen = user.createNestedArray(String(F("Pixel art screen ")) + (i + 1));
+			screen.add(screens[i]->imageLoaded ? screens[i]->name : String(F("waiting")));
+			screen.add(String(F(" on segment ")) + screens[i]->segmentId);
+		}
 	}
 
 	/*
@@ -781,8 +6401,26 @@ public:
 		// save these vars persistently whenever settings are saved
 		top["server url"] = serverName;
 		top["api key"] = apiKey;
-		top["screen id"] = clientName;
+		for (uint8_t i = 0; i < maxScreens; i++)
+		{
+			top[screenKey(i, "id")] = screenIds[i];
+			top[screenKey(i, "segment")] = screenSegments[i];
+		}
 		top["transparent"] = transparency;
+		top["max frames"] = maxFrames;
+		top["prefetch images"] = prefetchImages;
+		top["palette frames"] = paletteFrames;
+		top["gif images"] = gifImages;
+		top["keyframe interval"] = keyframeInterval;
+		top["cache size"] = cacheSize;
+		top["crossfade ms"] = crossfadeDuration;
+		top["crossfade easing"] = crossfadeEasing;
+		top["image fit"] = imageFit;
+		top["request size"] = requestSize;
+		top["mqtt metrics s"] = metricsInterval;
+		top["mqtt push"] = pushUpdates;
+		top["push topic"] = pushTopic;
+		top["manifest images"] = manifestImages;
 	}
 
 	/*
@@ -811,9 +6449,88 @@ public:
 
 		configComplete &= getJsonValue(top["enabled"], enabled);
 		configComplete &= getJsonValue(top["server url"], serverName);
-		configComplete &= getJsonValue(top["screen id"], clientName);
+		for (uint8_t i = 0; i < maxScreens; i++)
+		{
+			const String previousId = screenIds[i];
+			const unsigned int previousSegment = screenSegments[i];
+			// only the first screen is on by default
+			configComplete &= getJsonValue(top[screenKey(i, "id")], screenIds[i], i == 0 ? "WLED" : "");
+			configComplete &= getJsonValue(top[screenKey(i, "segment")], screenSegments[i], i);
+			screenSegments[i] = min(screenSegments[i], 255U);
+			// a screen that changed starts again with new slots, on the next loop
+			frameBuffersDirty |= (screenIds[i] != previousId || screenSegments[i] != previousSegment);
+		}
 		configComplete &= getJsonValue(top["api key"], apiKey);
 		configComplete &= getJsonValue(top["transparent"], transparency);
+		// images already loaded keep whatever they were stored as
+		for (Screen *screen : screens)
+		{
+			if (screen == nullptr)
+				continue;
+			for (ImageSlot &slot : screen->imageSlots)
+				slot.flattenOnLoad = !transparency;
+		}
+		configComplete &= getJsonValue(top["palette frames"], paletteFrames, true);
+		configComplete &= getJsonValue(top["gif images"], gifImages, false);
+		configComplete &= getJsonValue(top["keyframe interval"], keyframeInterval, 8);
+		keyframeInterval = constrain(keyframeInterval, 1, 255);
+		// only applies to images loaded from now on
+		for (Screen *screen : screens)
+		{
+			if (screen == nullptr)
+				continue;
+			for (ImageSlot &slot : screen->imageSlots)
+				slot.keyframeInterval = keyframeInterval;
+		}
+
+		const unsigned int previousCacheSize = cacheSize;
+		configComplete &= getJsonValue(top["cache size"], cacheSize, 256);
+		// on boot this waits for setup(), when the filesystem is ready
+		if (initDone && cacheSize != previousCacheSize)
+			cache.begin((size_t)cacheSize * 1024);
+
+		configComplete &= getJsonValue(top["crossfade ms"], crossfadeDuration, 1000);
+		crossfadeDuration = min(crossfadeDuration, 10000U);
+		configComplete &= getJsonValue(top["crossfade easing"], crossfadeEasing, LINEAR);
+		buildEasingTable();
+		configComplete &= getJsonValue(top["image fit"], imageFit, ScaleMap::FIT);
+		imageFit = min(imageFit, (uint8_t)ScaleMap::CENTRE);
+
+		const unsigned int previousRequestSize = requestSize;
+		configComplete &= getJsonValue(top["request size"], requestSize, 0);
+		requestSize = min(requestSize, 1024U);
+		// the JSON parser's row buffer is sized for it
+		frameBuffersDirty |= (requestSize != previousRequestSize);
+
+		const unsigned int previousMaxFrames = maxFrames;
+		configComplete &= getJsonValue(top["max frames"], maxFrames, 16);
+		maxFrames = constrain(maxFrames, 1, 255);
+		// resize the frame arenas on the next loop, rather than in the middle of a redraw
+		frameBuffersDirty |= (maxFrames != previousMaxFrames);
+
+		const unsigned int previousPrefetchImages = prefetchImages;
+		configComplete &= getJsonValue(top["prefetch images"], prefetchImages, 2);
+		prefetchImages = constrain(prefetchImages, 1, maxImageSlots - 1);
+		frameBuffersDirty |= (prefetchImages != previousPrefetchImages);
+
+		configComplete &= getJsonValue(top["mqtt metrics s"], metricsInterval, 0);
+		configComplete &= getJsonValue(top["mqtt push"], pushUpdates, false);
+		configComplete &= getJsonValue(top["push topic"], pushTopic, "pixelart");
+		// screen ids may have changed too
+		pushTopicsDirty = true;
+
+		const unsigned int previousManifestImages = manifestImages;
+		configComplete &= getJsonValue(top["manifest images"], manifestImages, 0);
+		manifestImages = min(manifestImages, (unsigned int)maxManifestImages);
+		// a server without manifests gets another try, and a new length starts each list again
+		for (Screen *screen : screens)
+		{
+			if (screen == nullptr)
+				continue;
+			screen->manifestUnsupported = false;
+			if (manifestImages != previousManifestImages)
+				screen->dropPlaylist();
+		}
 		return configComplete;
 	}
 
@@ -826,8 +6543,30 @@ public:
 	{
 		oappend(SET_F("addInfo('PixelArtClient:server url', 1, '');"));
 		oappend(SET_F("addInfo('PixelArtClient:screen id', 1, '');"));
+		oappend(SET_F("addInfo('PixelArtClient:segment', 1, 'the 2D segment to draw on');"));
+		oappend(SET_F("addInfo('PixelArtClient:screen 2 id', 1, 'more screens, each on its own segment. empty = off');"));
 		oappend(SET_F("addInfo('PixelArtClient:api key', 1, '');"));
 		oappend(SET_F("addField('PixelArtClient:transparent', 1, true);"));
+		oappend(SET_F("addInfo('PixelArtClient:max frames', 1, 'per image, each image kept uses frames x width x height x 4 bytes');"));
+		oappend(SET_F("addInfo('PixelArtClient:prefetch images', 1, 'fetched ahead of the one showing, fewer if the heap runs low');"));
+		oappend(SET_F("addInfo('PixelArtClient:palette frames', 1, 'images of up to 256 colours fit 4x the frames');"));
+		oappend(SET_F("addInfo('PixelArtClient:gif images', 1, 'fetch the original GIF and decode it here, if the server can send it');"));
+		oappend(SET_F("addInfo('PixelArtClient:keyframe interval', 1, 'frames between whole frames, the rest store only changed pixels. 1 = off');"));
+		oappend(SET_F("addInfo('PixelArtClient:cache size', 1, 'KB of flash for images already seen. 0 = off');"));
+		oappend(SET_F("addInfo('PixelArtClient:crossfade ms', 1, 'length of the fade between images');"));
+		oappend(SET_F("dd=addDropdown('PixelArtClient','crossfade easing');"));
+		oappend(SET_F("addOption(dd,'Linear',0);"));
+		oappend(SET_F("addOption(dd,'Ease in and out',1);"));
+		oappend(SET_F("addOption(dd,'Ease in',2);"));
+		oappend(SET_F("addOption(dd,'Ease out',3);"));
+		oappend(SET_F("dd=addDropdown('PixelArtClient','image fit');"));
+		oappend(SET_F("addOption(dd,'Fit',0);"));
+		oappend(SET_F("addOption(dd,'Fill',1);"));
+		oappend(SET_F("addOption(dd,'Centre',2);"));
+		oappend(SET_F("addInfo('PixelArtClient:request size', 1, 'ask for images this size and scale them here. 0 = the segment size');"));
+		oappend(SET_F("addInfo('PixelArtClient:mqtt metrics s', 1, 'publish fetch, draw and heap metrics this often. 0 = off');"));
+		oappend(SET_F("addInfo('PixelArtClient:mqtt push', 1, 'fetch when the server publishes to push topic/screen id, polling while MQTT is down');"));
+		oappend(SET_F("addInfo('PixelArtClient:manifest images', 1, 'playlist entries to fetch at once and schedule here, if the server has a manifest. 0 = off');"));
 	}
 
 	/*
@@ -837,48 +6576,19 @@ public:
 	 */
 	void handleOverlayDraw()
 	{
-		// draw currently cached image again
-		if (enabled && imageLoaded)
+		if (!enabled)
+			return;
+		const unsigned long drawStart = micros();
+		// each screen draws its own segment
+		bool drawn = false;
+		for (Screen *screen : screens)
 		{
-			// redrawing
-			// Serial.println("handleOverlayDraw() -> redrawing");
-
-			// cycle frames within a multi-frame image (ie animated gif)
-			if (millis() - refreshTime > currentFrameDuration)
-			{
-				// Serial.print("flipping frames: ");
-				// Serial.print(currentFrameIndex);
-				// Serial.print(" of ");
-				// Serial.print(currentImageFrameCount);
-				// Serial.println("");
-				refreshTime = millis();
-				currentFrameIndex++;
-				currentFrameIndex = currentFrameIndex % currentImageFrameCount;
-				// choose next frame in set to update
-				currentFrame = (*currentImage)[currentFrameIndex];
-				currentFrameDuration = (*currentImageDurations)[currentFrameIndex];
-			}
-
-			if (nextBlend > 0)
-			{
-				setPixelsFrom2DVector(currentFrame, nextFrame, nextBlend, currentImageBackgroundColour);
-				nextBlend += crossfadeIncrement;
-				// while(nextBlend<=255) {
-
-				// 	busses.show();
-				// 	delay(1000/crossfadeFrameRate);
-				// }
-				if (nextBlend > 255)
-				{
-					nextBlend = 0;
-					completeImageTransition();
-				}
-			}
-			else
-			{
-				setPixelsFrom2DVector(currentFrame, currentImageBackgroundColour);
-			}
+			if (screen != nullptr)
+				drawn |= screen->draw();
 		}
+		if (!drawn)
+			return;
+		metrics.recordDraw(micros() - drawStart);
 	}
 
 	/**
@@ -907,21 +6617,19 @@ public:
 	 */
 	bool onMqttMessage(char *topic, char *payload)
 	{
-		// check if we received a command
-		// if (strlen(topic) == 8 && strncmp_P(topic, PSTR("/command"), 8) == 0) {
-		//  String action = payload;
-		//  if (action == "on") {
-		//    enabled = true;
-		//    return true;
-		//  } else if (action == "off") {
-		//    enabled = false;
-		//    return true;
-		//  } else if (action == "toggle") {
-		//    enabled = !enabled;
-		//    return true;
-		//  }
-		//}
-		return false;
+		// <push topic>/<screen id>: "image" when the image showing changed, "playlist" when the playlist did,
+		// "show" to put the next image up now. all of them fetch and show the screen's next image straight away.
+		// this runs on the MQTT client's task, so it only reads the fixed topics and flags the screen for loop()
+		bool handled = false;
+		for (uint8_t i = 0; i < maxScreens; i++)
+		{
+			if (pushSubscriptions[i][0] == '\0' || strcmp(topic, pushSubscriptions[i]) != 0)
+				continue;
+			handled = true;
+			if (strcmp_P(payload, PSTR("image")) == 0 || strcmp_P(payload, PSTR("playlist")) == 0 || strcmp_P(payload, PSTR("show")) == 0)
+				pushReceived[i] = true;
+		}
+		return handled;
 	}
 
 	/**
@@ -929,8 +6637,10 @@ public:
 	 */
 	void onMqttConnect(bool sessionPresent)
 	{
-		// do any MQTT related initialisation here
-		// publishMqtt("I am alive!");
+		// the broker may have forgotten our subscriptions. this runs on the MQTT client's task, so only flag it
+		// for loop() to make them again
+		pushResubscribe = true;
+		pushTopicsDirty = true;
 	}
 #endif
 
@@ -962,7 +6672,10 @@ const char PixelArtClient::_enabled[] PROGMEM = "enabled";
 
 // implementation of non-inline member methods
 
-void PixelArtClient::publishMqtt(const char *state, bool retain)
+/**
+ * publish to <device topic>/pixelart/<topic>
+ */
+void PixelArtClient::publishMqtt(const char *topic, const char *state, bool retain)
 {
 #ifndef WLED_DISABLE_MQTT
 	// Check if MQTT Connected, otherwise it will crash the 8266
@@ -970,7 +6683,8 @@ void PixelArtClient::publishMqtt(const char *state, bool retain)
 	{
 		char subuf[64];
 		strcpy(subuf, mqttDeviceTopic);
-		strcat_P(subuf, PSTR("/example"));
+		strcat_P(subuf, PSTR("/pixelart/"));
+		strncat(subuf, topic, sizeof(subuf) - strlen(subuf) - 1);
 		mqtt->publish(subuf, 0, retain, state);
 	}
 #endif